@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+#include <mapped_file.hpp>
+#include <math.hpp>
+#include <toolpath.hpp>
+
+namespace pusn {
+
+// a parsed program stored next to the other caches and mapped back without
+// copies. The arrays point straight into the mapping, distance[i] is the
+// length of the path up to move i so segment lengths and the move reached
+// after a given distance need no pass over the program. 5 axis programs
+// also carry the tool axis of every move.
+class compiled_toolpath {
+public:
+  // the compiled form of program from cache_dir, compiling and storing it
+  // first when it is missing or older than the program
+  static std::optional<compiled_toolpath>
+  load(const std::filesystem::path &program,
+       const std::filesystem::path &cache_dir = "cache");
+
+  inline const tool_info &tool() const { return tool_; }
+  inline std::size_t size() const { return x_.size(); }
+  inline bool empty() const { return x_.empty(); }
+
+  inline std::span<const float> x() const { return x_; }
+  inline std::span<const float> y() const { return y_; }
+  inline std::span<const float> z() const { return z_; }
+  inline std::span<const std::uint32_t> line() const { return line_; }
+  inline std::span<const float> distance() const { return distance_; }
+  // empty unless has_orientation()
+  inline std::span<const float> i() const { return i_; }
+  inline std::span<const float> j() const { return j_; }
+  inline std::span<const float> k() const { return k_; }
+  inline bool has_orientation() const { return !i_.empty(); }
+
+  inline math::vec3 position(std::size_t i) const {
+    return {x_[i], y_[i], z_[i]};
+  }
+  // unit tool axis at move i, +z for 3 axis programs
+  inline math::vec3 tool_axis(std::size_t i) const {
+    return has_orientation() ? math::vec3{i_[i], j_[i], k_[i]}
+                             : math::vec3{0.f, 0.f, 1.f};
+  }
+  inline float length() const {
+    return distance_.empty() ? 0.f : distance_.back();
+  }
+  // length of the segment from move i - 1 to move i, 0 for the first move
+  inline float segment_length(std::size_t i) const {
+    return i == 0 ? 0.f : distance_[i] - distance_[i - 1];
+  }
+  // the move ending the segment the tool is on after travelling d, 0 for
+  // programs of fewer than two moves
+  std::size_t segment_at(float d) const;
+
+  inline const math::vec3 &bounds_min() const { return bounds_min_; }
+  inline const math::vec3 &bounds_max() const { return bounds_max_; }
+
+private:
+  utils::mapped_file file_;
+  tool_info tool_;
+  math::vec3 bounds_min_{0.f};
+  math::vec3 bounds_max_{0.f};
+  std::span<const float> x_;
+  std::span<const float> y_;
+  std::span<const float> z_;
+  std::span<const std::uint32_t> line_;
+  std::span<const float> distance_;
+  std::span<const float> i_;
+  std::span<const float> j_;
+  std::span<const float> k_;
+};
+
+} // namespace pusn
@@ -18,6 +18,14 @@ struct scene_object_info {
   math::vec3 scale{1.f, 1.f, 1.f};
 };
 
+// placement of an interpolated instance, the rotation stays a quaternion
+// all the way to the model matrix
+struct placement {
+  math::vec3 position{0.f, 0.f, 0.f};
+  glm::quat rotation{1.f, 0.f, 0.f, 0.f};
+  math::vec3 scale{1.f, 1.f, 1.f};
+};
+
 struct api_agnostic_geometry {
   std::vector<pos_norm_col> vertices;
   std::vector<unsigned int> indices;
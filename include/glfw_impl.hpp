@@ -1,11 +1,19 @@
 #pragma once
 
+#include <cstdint>
+#include <span>
+#include <vector>
+
 #include <geometry.hpp>
+#include <heightmap.hpp>
+#include <vertex_format.hpp>
 #include <inputs.hpp>
 #include <logger.hpp>
 
 #include <glfw_impl/common.hpp>
 #include <glfw_impl/framebuffer.hpp>
+#include <glfw_impl/heightmap_texture.hpp>
+#include <glfw_impl/resources.hpp>
 
 namespace pusn {
 
@@ -20,12 +28,67 @@ void swap_buffers(window_t &w);
 void poll_events(window_t &w);
 void fill_renderable(std::vector<pos_norm_col> &vertices,
                      std::vector<unsigned int> &indices, renderable &out);
+// packed_vertex attributes, the normal arrives octahedral encoded
+void fill_renderable(const packed_mesh &mesh, renderable &out);
+// positions given as separate x, y and z arrays, attributes 0, 1 and 2 are
+// one float each
+void fill_renderable(std::span<const float> x, std::span<const float> y,
+                     std::span<const float> z,
+                     const std::vector<std::uint32_t> &indices,
+                     renderable &out);
 void add_program_to_renderable(const std::string &program_name,
                                renderable &out);
+// program_name.comp only, the renderable keeps no geometry
+void add_compute_program_to_renderable(const std::string &program_name,
+                                       renderable &out);
+// runs the bound compute program and makes its storage writes visible to
+// the following draws
+void dispatch_compute(std::size_t invocations, std::size_t local_size);
 inline auto get_ticks() { return glfwGetTime(); }
 void use_program(GLuint program);
 void render(const renderable &meta, const api_agnostic_geometry &geom,
             render_mode mode = render_mode::triangles);
+// index_count indices starting at first_index
+void render(const renderable &meta, std::size_t first_index,
+            std::size_t index_count,
+            render_mode mode = render_mode::triangles);
+void fill_buffer(const void *data, std::size_t size, buffer_t &out);
+void bind_uniform_buffer(buffer_t &buffer, GLuint binding);
+void bind_storage_buffer(buffer_t &buffer, GLuint binding);
+// stream buffers, data written between begin and end of a frame must not be
+// touched after end_stream_frame
+void begin_stream_frame(stream_buffer &stream);
+stream_allocation stream_allocate(stream_buffer &stream, std::size_t size);
+void bind_stream_range(stream_buffer &stream,
+                       const stream_allocation &allocation, GLenum target,
+                       GLuint binding);
+void end_stream_frame(stream_buffer &stream);
+// draws instance_count copies of the geometry, per instance data comes from
+// whatever storage buffer the program reads
+void render_instanced(const renderable &meta,
+                      const api_agnostic_geometry &geom,
+                      std::size_t instance_count,
+                      render_mode mode = render_mode::triangles);
+// same for index_count indices starting at first_index
+void render_instanced(const renderable &meta, std::size_t first_index,
+                      std::size_t index_count, std::size_t instance_count,
+                      render_mode mode = render_mode::triangles);
+
+// uploads the dirty tiles of map and clears their flags, the whole map when
+// the texture is created or its size or format changed. The tile variances
+// follow whenever a tile was dirty.
+void upload_heightmap(heightmap_texture &out, heightmap &map);
+// one quad patch per tile of map, drawn as render_mode::patches with the
+// heightmap program. The tile coordinates go in the color attribute.
+void fill_heightmap_patches(const heightmap &map, renderable &out);
+// links resources/heightmap into out.patches and looks its uniforms up
+void add_heightmap_program(heightmap_renderable &out);
+// the patches of map displaced by texture, tessellated for the viewport of
+// draw. The texture goes to unit 0 and the tile variances to
+// heightmap_texture::patch_variance_binding.
+void render_heightmap(const heightmap_renderable &meta,
+                      heightmap_texture &texture, const heightmap &map,
+                      const heightmap_draw &draw);
 
 template <typename TextureDataType>
 void fill_texture(texture_t &texture, int x, int y,
@@ -91,19 +154,74 @@ void fill_texture(texture_t &texture, int x, int y,
 }
 
 template <typename UniformType>
-inline void set_uniform(const std::string &name, GLuint program,
-                        const UniformType &value) {
+inline void set_uniform(GLint location, const UniformType &value) {
   if constexpr (std::is_same_v<math::mat4, UniformType>) {
-    glUniformMatrix4fv(glGetUniformLocation(program, name.c_str()), 1, GL_FALSE,
-                       math::get_value_ptr(value));
+    glUniformMatrix4fv(location, 1, GL_FALSE, math::get_value_ptr(value));
+  }
+
+  if constexpr (std::is_same_v<math::mat3, UniformType>) {
+    glUniformMatrix3fv(location, 1, GL_FALSE, math::get_value_ptr(value));
   }
 
   if constexpr (std::is_same_v<math::vec3, UniformType>) {
-    glUniform3f(glGetUniformLocation(program, name.c_str()), value.x, value.y,
-                value.z);
+    glUniform3f(location, value.x, value.y, value.z);
+  }
+
+  if constexpr (std::is_same_v<math::vec4, UniformType>) {
+    glUniform4f(location, value.x, value.y, value.z, value.w);
+  }
+
+  if constexpr (std::is_same_v<math::vec2, UniformType>) {
+    glUniform2f(location, value.x, value.y);
+  }
+
+  if constexpr (std::is_same_v<math::ivec2, UniformType>) {
+    glUniform2i(location, value.x, value.y);
+  }
+
+  if constexpr (std::is_same_v<float, UniformType>) {
+    glUniform1f(location, value);
+  }
+
+  if constexpr (std::is_same_v<GLuint, UniformType>) {
+    glUniform1ui(location, value);
+  }
+
+  if constexpr (std::is_same_v<GLint, UniformType>) {
+    glUniform1i(location, value);
   }
 }
 
+// queries the driver, for programs not linked by add_program_to_renderable
+template <typename UniformType>
+inline void set_uniform(const std::string &name, GLuint program,
+                        const UniformType &value) {
+  set_uniform(glGetUniformLocation(program, name.c_str()), value);
+}
+
+// packed meshes sharing one vertex and one 16 bit index buffer. Every mesh
+// keeps its own short indices and is drawn with a base vertex, so the arena
+// can grow past 65k vertices in total.
+struct mesh_arena {
+  packed_mesh mesh;
+  renderable meta;
+};
+
+struct mesh_range {
+  GLint base_vertex{0};
+  GLuint first_index{0};
+  GLuint index_count{0};
+};
+
+// meshes need short indices, call upload_arena after the last one
+mesh_range add_to_arena(const packed_mesh &mesh, mesh_arena &arena);
+void upload_arena(mesh_arena &arena);
+// one glMultiDrawElementsIndirect over command_count commands stored at
+// offset in the indirect buffer, the program has to be bound already
+void render_indirect(const renderable &meta, GLuint indirect_buffer,
+                     std::size_t offset, std::size_t command_count,
+                     render_mode mode = render_mode::triangles);
+
 // utils
 inline mouse_state::mouse_button mbutton_glfw_to_enum(int glfw_mbutton);
 
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <memory>
 #include <optional>
+#include <string>
+#include <unordered_map>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -45,6 +49,46 @@ struct key_mappings {
   static constexpr int key_backward = GLFW_KEY_S;
 };
 
+// persistently mapped, coherent buffer for data rewritten every frame. It is
+// split into region_count regions used round robin, one per frame, and a
+// fence per region keeps the cpu from overwriting what the gpu still reads.
+// Within a frame the region is handed out linearly by stream_allocate.
+struct stream_buffer {
+  static constexpr std::size_t region_count = 3;
+
+  std::optional<GLuint> index;
+  std::byte *mapped{nullptr};
+  std::size_t region_size{0};
+  std::size_t alignment{256};
+
+  std::size_t region{0};
+  std::size_t offset{0};
+  std::array<GLsync, region_count> fences{};
+
+  inline GLuint value() { return index.value(); }
+  inline bool has_value() { return index.has_value(); }
+};
+
+// part of the current stream region, data points into the mapping and
+// offset is relative to the start of the whole buffer
+struct stream_allocation {
+  std::byte *data{nullptr};
+  std::size_t offset{0};
+  std::size_t size{0};
+};
+
+// per viewport data shared by every program, std140 block "frame" at
+// binding frame_uniforms::binding, vec3 values are padded to vec4
+struct frame_uniforms {
+  static constexpr GLuint binding = 0;
+
+  math::mat4 view;
+  math::mat4 proj;
+  math::vec4 light_pos;
+  math::vec4 light_color;
+  math::vec4 cam_pos;
+};
+
 enum class render_mode { triangles, patches, line_strip };
 
 struct renderable {
@@ -52,7 +96,40 @@ struct renderable {
   std::optional<GLuint> ebo;
   std::optional<GLuint> vbo;
 
+  // GL_UNSIGNED_SHORT for packed meshes with short indices
+  GLenum index_type{GL_UNSIGNED_INT};
+
   std::optional<GLuint> program;
+  // active uniforms of the program, resolved once when it is linked. Owners
+  // look their locations up here once and keep them for the draws.
+  std::unordered_map<std::string, GLint> uniform_locations;
+
+  inline GLint uniform_location(const std::string &name) const {
+    const auto it = uniform_locations.find(name);
+    return it == uniform_locations.end() ? -1 : it->second;
+  }
+};
+
+inline std::size_t index_size(GLenum index_type) {
+  return index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+// layout glMultiDrawElementsIndirect reads from the indirect buffer
+struct draw_elements_indirect_command {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+// storage or uniform buffer that only reallocates when the data outgrows it
+struct buffer_t {
+  std::optional<GLuint> index;
+  std::size_t capacity{0};
+
+  inline GLuint value() { return index.value(); }
+  inline bool has_value() { return index.has_value(); }
 };
 } // namespace glfw_impl
 } // namespace pusn
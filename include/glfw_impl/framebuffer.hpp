@@ -1,118 +1,99 @@
 #pragma once
 
+#include <algorithm>
+
 #include <geometry.hpp>
 #include <glfw_impl/common.hpp>
+#include <glfw_impl/resources.hpp>
 #include <logger.hpp>
 
 namespace pusn {
 
 namespace glfw_impl {
 
-struct frambuffer {
+// color and depth target of one viewport. Storage is allocated in size
+// buckets and only reallocated when the requested area outgrows it, a smaller
+// area renders into the lower left corner of the existing textures.
+struct render_target {
+  static constexpr uint32_t bucket = 256;
+
+  // area in use
   uint32_t width{1};
   uint32_t height{1};
-
-  bool left{true};
-
-  renderable meta;
-  api_agnostic_geometry geom;
-  std::optional<GLuint> of_fb;
-  std::optional<GLuint> color_left;
-  std::optional<GLuint> color_right;
-  std::optional<GLuint> depth;
-
-  // frambuffer utils
-  void setup() {
-    if (!of_fb.has_value()) {
-      GLuint tmp;
-      glCreateFramebuffers(1, &tmp);
-      of_fb = tmp;
-    }
-
-    width = std::max<float>(1.0f, width);
-    height = std::max<float>(1.0f, height);
-
-    if (left) {
-      GLuint tmp = color_left.has_value() ? color_left.value() : 0;
-
-      if (color_left.has_value()) {
-        glDeleteTextures(1, &tmp);
-        color_left.reset();
-      }
-
-      glCreateTextures(GL_TEXTURE_2D, 1, &tmp);
-      color_left = tmp;
-
-      glTextureParameteri(tmp, GL_TEXTURE_WRAP_S, GL_REPEAT);
-      glTextureParameteri(tmp, GL_TEXTURE_WRAP_T, GL_REPEAT);
-      glTextureParameteri(tmp, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTextureParameteri(tmp, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      glTextureStorage2D(tmp, 1, GL_RGBA8, width, height);
-
-      glNamedFramebufferTexture(of_fb.value(), GL_COLOR_ATTACHMENT0,
-                                color_left.value(), 0);
+  // allocated storage
+  uint32_t capacity_width{0};
+  uint32_t capacity_height{0};
+
+  unique_framebuffer fb;
+  unique_texture color;
+  unique_texture depth;
+
+  void resize(float w, float h) {
+    width = static_cast<uint32_t>(std::max(1.f, w));
+    height = static_cast<uint32_t>(std::max(1.f, h));
+    if (width <= capacity_width && height <= capacity_height) {
+      return;
     }
 
-    if (!left) {
-      GLuint tmp = color_right.has_value() ? color_right.value() : 0;
-
-      if (color_right.has_value()) {
-        glDeleteTextures(1, &tmp);
-        color_right.reset();
-      }
-
-      glCreateTextures(GL_TEXTURE_2D, 1, &tmp);
-      color_right = tmp;
-
-      glTextureParameteri(tmp, GL_TEXTURE_WRAP_S, GL_REPEAT);
-      glTextureParameteri(tmp, GL_TEXTURE_WRAP_T, GL_REPEAT);
-      glTextureParameteri(tmp, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTextureParameteri(tmp, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      glTextureStorage2D(tmp, 1, GL_RGBA8, width, height);
+    // grow both sides at once to the next bucket, never shrink
+    capacity_width =
+        std::max(capacity_width, (width + bucket - 1) / bucket * bucket);
+    capacity_height =
+        std::max(capacity_height, (height + bucket - 1) / bucket * bucket);
 
-      glNamedFramebufferTexture(of_fb.value(), GL_COLOR_ATTACHMENT0,
-                                color_right.value(), 0);
+    if (!fb.has_value()) {
+      fb = create_framebuffer();
     }
 
-    GLuint tmp = depth.has_value() ? depth.value() : 0;
-    if (depth.has_value()) {
-      glDeleteTextures(1, &tmp);
-    }
+    color = create_texture_2d(GL_RGBA8, capacity_width, capacity_height);
+    glTextureParameteri(color.value(), GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(color.value(), GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(color.value(), GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(color.value(), GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    glCreateTextures(GL_TEXTURE_2D, 1, &tmp);
-    depth = tmp;
-    // depth
+    depth = create_texture_2d(GL_DEPTH24_STENCIL8, capacity_width,
+                              capacity_height);
     glTextureParameteri(depth.value(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTextureParameteri(depth.value(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTextureParameteri(depth.value(), GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTextureParameteri(depth.value(), GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTextureStorage2D(depth.value(), 1, GL_DEPTH24_STENCIL8, width, height);
 
-    // final setup
-    glNamedFramebufferTexture(of_fb.value(), GL_DEPTH_STENCIL_ATTACHMENT,
+    glNamedFramebufferTexture(fb.value(), GL_COLOR_ATTACHMENT0, color.value(),
+                              0);
+    glNamedFramebufferTexture(fb.value(), GL_DEPTH_STENCIL_ATTACHMENT,
                               depth.value(), 0);
 
-    if (glCheckNamedFramebufferStatus(of_fb.value(), GL_FRAMEBUFFER) !=
+    if (glCheckNamedFramebufferStatus(fb.value(), GL_FRAMEBUFFER) !=
         GL_FRAMEBUFFER_COMPLETE) {
       LOGGER_CRITICAL("Framebuffer creation failed!");
     }
     GLenum draw_bufs[] = {GL_COLOR_ATTACHMENT0};
-    glNamedFramebufferDrawBuffers(of_fb.value(), 1, draw_bufs);
+    glNamedFramebufferDrawBuffers(fb.value(), 1, draw_bufs);
   }
 
-  void bind() { glBindFramebuffer(GL_FRAMEBUFFER, of_fb.value()); }
+  // binds the target and limits drawing and clearing to the area in use
+  void bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fb.value());
+    glViewport(0, 0, width, height);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, width, height);
+  }
 
-  void set_left() {
-    glNamedFramebufferTexture(of_fb.value(), GL_COLOR_ATTACHMENT0,
-                              color_left.value(), 0);
+  void unbind() {
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
   }
 
-  void set_right() {
-    glNamedFramebufferTexture(of_fb.value(), GL_COLOR_ATTACHMENT0,
-                              color_right.value(), 0);
+  // texture coordinates of the upper right corner of the area in use
+  math::vec2 uv_extent() const {
+    return {static_cast<float>(width) / capacity_width,
+            static_cast<float>(height) / capacity_height};
   }
+};
 
-  void unbind() { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+struct frambuffer {
+  render_target left;
+  render_target right;
 };
 
 } // namespace glfw_impl
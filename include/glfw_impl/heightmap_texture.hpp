@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glfw_impl/common.hpp>
+#include <glfw_impl/resources.hpp>
+
+namespace pusn {
+
+namespace glfw_impl {
+
+// texel formats of an uploaded heightmap. The 16 bit ones halve the upload
+// and the texture memory: r16f stores halves, r16 stores
+// (h - offset) / scale as unorm, sampled back as offset + scale * texel.
+enum class heightmap_format { r32f, r16f, r16 };
+
+// gpu copy of a heightmap, kept in sync by upload_heightmap from the tiles
+// the heightmap marks dirty
+struct heightmap_texture {
+  heightmap_format format{heightmap_format::r32f};
+  // heights r16 covers, [offset, offset + scale]
+  float offset{0.f};
+  float scale{1.f};
+
+  unique_texture texture;
+  int width{0};
+  int height{0};
+  heightmap_format texture_format{heightmap_format::r32f};
+  // offset and scale the r16 texels were packed with
+  float texture_offset{0.f};
+  float texture_scale{1.f};
+
+  // ring of pixel unpack regions the dirty tiles are written to, the copies
+  // into the texture then run on the gpu while the frame goes on
+  stream_buffer staging;
+  // dirty bytes per upload beyond which the rest goes straight from client
+  // memory, it keeps a full refresh from growing the staging ring
+  std::size_t staging_budget{4u << 20};
+
+  // heightmap::tile_variance, read by heightmap.tesc to pick the levels
+  buffer_t patch_variance;
+  static constexpr GLuint patch_variance_binding = 3;
+
+  inline GLuint value() const { return texture.value(); }
+  inline bool has_value() const { return texture.has_value(); }
+
+  // what a sampled texel is mapped by to get the height back, the float
+  // formats hold the heights themselves
+  inline float sample_offset() const {
+    return texture_format == heightmap_format::r16 ? texture_offset : 0.f;
+  }
+  inline float sample_scale() const {
+    return texture_format == heightmap_format::r16 ? texture_scale : 1.f;
+  }
+};
+
+// the heightmap program and the patches it draws, see
+// fill_heightmap_patches. The uniforms are resolved by add_heightmap_program.
+struct heightmap_renderable {
+  renderable patches;
+  GLint model{-1};
+  GLint viewport{-1};
+  GLint patch_grid{-1};
+  GLint height_map{-1};
+  GLint height_offset{-1};
+  GLint height_scale{-1};
+  GLint edge_pixels{-1};
+  GLint max_error_pixels{-1};
+  GLint color{-1};
+};
+
+// what a viewport draws the heightmap with
+struct heightmap_draw {
+  math::mat4 model{1.f};
+  // size of the viewport in pixels
+  math::vec2 viewport{1.f};
+  // length of a tessellated edge and error of the heights on screen
+  float edge_pixels{8.f};
+  float max_error_pixels{1.f};
+  math::vec4 color{0.75f, 0.75f, 0.78f, 1.f};
+};
+
+// largest difference between a height in [offset, offset + scale] and the
+// height its texel samples back as
+float quantization_error(heightmap_format format, float offset, float scale);
+
+} // namespace glfw_impl
+} // namespace pusn
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <utility>
+
+#include <glfw_impl/common.hpp>
+
+namespace pusn {
+
+namespace glfw_impl {
+
+enum class resource_kind { texture, buffer, framebuffer, vertex_array, program };
+
+// queues the name for deletion once the gpu is done with the frames that may
+// still use it, see collect_deferred_deletions
+void defer_deletion(resource_kind kind, GLuint name);
+// fences the names queued this frame and deletes the ones whose fence passed,
+// called once per frame
+void collect_deferred_deletions();
+
+// owning handle of a gl object name, move only. Releasing goes through the
+// deferred deletion queue so an object can be dropped while draws recorded
+// this frame still reference it.
+template <resource_kind Kind> struct unique_resource {
+  GLuint name{0};
+
+  unique_resource() = default;
+  explicit unique_resource(GLuint n) : name(n) {}
+  unique_resource(const unique_resource &) = delete;
+  unique_resource &operator=(const unique_resource &) = delete;
+  unique_resource(unique_resource &&other) noexcept
+      : name(std::exchange(other.name, 0)) {}
+  unique_resource &operator=(unique_resource &&other) noexcept {
+    if (this != &other) {
+      reset(std::exchange(other.name, 0));
+    }
+    return *this;
+  }
+  ~unique_resource() { reset(); }
+
+  inline void reset(GLuint n = 0) {
+    if (name != 0) {
+      defer_deletion(Kind, name);
+    }
+    name = n;
+  }
+
+  inline GLuint value() const { return name; }
+  inline bool has_value() const { return name != 0; }
+};
+
+using unique_texture = unique_resource<resource_kind::texture>;
+using unique_buffer = unique_resource<resource_kind::buffer>;
+using unique_framebuffer = unique_resource<resource_kind::framebuffer>;
+using unique_vertex_array = unique_resource<resource_kind::vertex_array>;
+using unique_program = unique_resource<resource_kind::program>;
+
+inline unique_texture create_texture_2d(GLenum internal_format, GLsizei width,
+                                        GLsizei height) {
+  GLuint tmp;
+  glCreateTextures(GL_TEXTURE_2D, 1, &tmp);
+  glTextureStorage2D(tmp, 1, internal_format, width, height);
+  return unique_texture(tmp);
+}
+
+inline unique_framebuffer create_framebuffer() {
+  GLuint tmp;
+  glCreateFramebuffers(1, &tmp);
+  return unique_framebuffer(tmp);
+}
+
+inline unique_buffer create_buffer() {
+  GLuint tmp;
+  glCreateBuffers(1, &tmp);
+  return unique_buffer(tmp);
+}
+
+} // namespace glfw_impl
+} // namespace pusn
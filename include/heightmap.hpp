@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <math.hpp>
+
+namespace pusn {
+
+// rectangle of heightmap cells [x0, x1) x [y0, y1), empty when x0 >= x1
+struct heightmap_region {
+  int x0{0};
+  int y0{0};
+  int x1{0};
+  int y1{0};
+
+  inline bool empty() const { return x0 >= x1 || y0 >= y1; }
+  inline void merge(const heightmap_region &other) {
+    if (other.empty()) {
+      return;
+    }
+    if (empty()) {
+      *this = other;
+      return;
+    }
+    x0 = std::min(x0, other.x0);
+    y0 = std::min(y0, other.y0);
+    x1 = std::max(x1, other.x1);
+    y1 = std::max(y1, other.y1);
+  }
+};
+
+// top of the material over the xy plane of the program, row major with rows
+// along y. Cell (i, j) covers origin + [i, i + 1) x [j, j + 1) * cell_size.
+struct heightmap {
+  // side of the square tiles the map is cut and uploaded in, a tile of floats
+  // stays in the l1 and l2 caches of the thread cutting it
+  static constexpr int tile_size = 64;
+
+  int width{0};
+  int height{0};
+  math::vec2 origin{0.f};
+  math::vec2 cell_size{1.f};
+  std::vector<float> heights;
+  // one flag per tile changed since the last upload, row major
+  std::vector<std::uint8_t> dirty_tiles;
+  // variance of the heights of every tile about the bilinear patch through
+  // its corners, the error of drawing the tile as a single quad. Row major
+  // like dirty_tiles, kept up to date by whoever changes the heights.
+  std::vector<float> tile_variance;
+
+  inline int tiles_x() const { return (width + tile_size - 1) / tile_size; }
+  inline int tiles_y() const { return (height + tile_size - 1) / tile_size; }
+  inline heightmap_region tile_region(int tx, int ty) const {
+    return {tx * tile_size, ty * tile_size,
+            std::min(width, (tx + 1) * tile_size),
+            std::min(height, (ty + 1) * tile_size)};
+  }
+
+  inline void mark_dirty() {
+    dirty_tiles.assign(static_cast<std::size_t>(tiles_x()) * tiles_y(), 1);
+  }
+  inline void mark_dirty(const heightmap_region &region) {
+    if (region.empty()) {
+      return;
+    }
+    for (int ty = region.y0 / tile_size; ty <= (region.y1 - 1) / tile_size;
+         ++ty) {
+      for (int tx = region.x0 / tile_size; tx <= (region.x1 - 1) / tile_size;
+           ++tx) {
+        dirty_tiles[static_cast<std::size_t>(ty) * tiles_x() + tx] = 1;
+      }
+    }
+  }
+
+  inline void measure_tile(int tx, int ty) {
+    const auto region = tile_region(tx, ty);
+    const float h00 = at(region.x0, region.y0);
+    const float h10 = at(region.x1 - 1, region.y0);
+    const float h01 = at(region.x0, region.y1 - 1);
+    const float h11 = at(region.x1 - 1, region.y1 - 1);
+    const float su = region.x1 - region.x0 > 1
+                         ? 1.f / static_cast<float>(region.x1 - region.x0 - 1)
+                         : 0.f;
+    const float sv = region.y1 - region.y0 > 1
+                         ? 1.f / static_cast<float>(region.y1 - region.y0 - 1)
+                         : 0.f;
+    float sum = 0.f;
+    for (int y = region.y0; y < region.y1; ++y) {
+      const float v = static_cast<float>(y - region.y0) * sv;
+      const float left = h00 + v * (h01 - h00);
+      const float right = h10 + v * (h11 - h10);
+      const float *row = &at(0, y);
+      for (int x = region.x0; x < region.x1; ++x) {
+        const float u = static_cast<float>(x - region.x0) * su;
+        const float e = row[x] - (left + u * (right - left));
+        sum += e * e;
+      }
+    }
+    tile_variance[static_cast<std::size_t>(ty) * tiles_x() + tx] =
+        sum / static_cast<float>((region.x1 - region.x0) *
+                                 (region.y1 - region.y0));
+  }
+  inline void measure() {
+    tile_variance.resize(static_cast<std::size_t>(tiles_x()) * tiles_y());
+    for (int ty = 0; ty < tiles_y(); ++ty) {
+      for (int tx = 0; tx < tiles_x(); ++tx) {
+        measure_tile(tx, ty);
+      }
+    }
+  }
+
+  inline float &at(int x, int y) {
+    return heights[static_cast<std::size_t>(y) * width + x];
+  }
+  inline const float &at(int x, int y) const {
+    return heights[static_cast<std::size_t>(y) * width + x];
+  }
+};
+
+} // namespace pusn
@@ -1,13 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
 #include <vector>
 
 #include <glad/glad.h>
 
+#include <compiled_toolpath.hpp>
 #include <geometry.hpp>
 #include <glfw_impl.hpp>
-#include <mock_data.hpp>
+#include <heightmap.hpp>
+#include <math/affine_batch.hpp>
+#include <mesh_baker.hpp>
+#include <milling.hpp>
+#include <tool_orientation.hpp>
+#include <toolpath_lod.hpp>
+#include <trajectory.hpp>
 
 #include <atomic>
 
@@ -18,23 +29,6 @@ namespace internal {
 //    * geometry
 //    * API object reference
 
-struct simulation_settings {
-  float length{5.f};
-  decltype(std::chrono::system_clock::now()) start_time;
-  math::vec3 position_start{0.f, 0.f, 0.f};
-  math::vec3 position_end{500.f, 0.f, 0.f};
-
-  glm::quat quat_rotation_start{1.f, 0.f, 0.f, 0.f};
-  glm::quat quat_rotation_end{1.f, 0.f, 0.f, 0.f};
-
-  glm::vec3 euler_rotation_start{0.f, 0.f, 0.f};
-  glm::vec3 euler_rotation_end{2 * glm::pi<float>(), 0.f, 0.f};
-
-  bool slerp{true};
-  bool animation{true};
-  int frames{10};
-};
-
 struct light {
   scene_object_info placement{{200.f, 100.f, 200.f}, {}, {}};
   math::vec3 color{1.f, 1.f, 1.f};
@@ -48,6 +42,8 @@ struct scene_grid {
                                  {0, 1, 2, 2, 3, 0}};
   scene_object_info placement;
   glfw_impl::renderable api_renderable;
+  // resolved once the program is linked
+  GLint model_location{-1};
 };
 
 struct model {
@@ -56,23 +52,143 @@ struct model {
 
   std::optional<simulation_settings> current_settings;
   simulation_settings next_settings;
+  trajectory_cache cache;
+  trajectory_evaluators evaluators;
+
+  std::vector<placement> left_placements{
+      placement{{0.f, 100.f, 0.f}, {1.f, 0.f, 0.f, 0.f}, {1.f, 1.f, 1.f}}};
+
+  std::vector<placement> right_placements{
+      placement{{0.f, -100.f, 0.f}, {1.f, 0.f, 0.f, 0.f}, {1.f, 1.f, 1.f}}};
+
+  // model and normal matrices of each viewport's strip, mirrored in the
+  // storage buffer read by model.vert. Animated placements change every
+  // frame and are streamed instead.
+  struct instances {
+    std::vector<math::affine_transform> transforms;
+    glfw_impl::buffer_t buffer;
+    bool dirty{true};
+  };
+  instances left_instances;
+  instances right_instances;
+
+  // plain start to end runs are evaluated by trajectory.comp, the motions
+  // are uploaded once and a frame only sets the time
+  struct gpu_motions {
+    glfw_impl::buffer_t motions;
+    glfw_impl::buffer_t transforms;
+    std::size_t count{0};
+  };
+  gpu_motions left_motions;
+  gpu_motions right_motions;
+  bool gpu_animated{false};
+  glfw_impl::renderable trajectory_program;
+  GLint time_location{-1};
+  GLint instance_count_location{-1};
+
+  // level of detail of every instance drawn this frame
+  std::vector<std::uint8_t> instance_lods;
+
+  // every level of detail of the tool, see mesh_baker, and where it lives
+  // in the scene's mesh arena
+  baked_mesh mesh;
+  glfw_impl::mesh_range mesh_range;
+  glfw_impl::renderable api_renderable;
 
-  std::vector<scene_object_info> left_placements{
-      scene_object_info{{0.f, 100.f, 0.f}, {0.f, 0.f, 0.f}, {1.f, 1.f, 1.f}}};
+  // placements were rewritten, upload them before the next draw
+  inline void mark_placements_dirty() {
+    left_instances.dirty = true;
+    right_instances.dirty = true;
+  }
+
+  // called once the run in current_settings is set up
+  inline void start_gpu_animation() {
+    const auto &settings = current_settings.value();
+    gpu_animated = gpu_evaluable(settings);
+    if (!gpu_animated) {
+      return;
+    }
+    auto upload = [&](gpu_motions &out, bool euler) {
+      const auto motion = make_instance_motion(settings, cache, euler, 0.f);
+      out.count = 1;
+      glfw_impl::fill_buffer(&motion, sizeof(motion), out.motions);
+      glfw_impl::fill_buffer(nullptr, sizeof(math::affine_transform),
+                             out.transforms);
+    };
+    upload(left_motions, false);
+    upload(right_motions, true);
+
+    // the start pose stands in for the lod selection while the gpu animates
+    const float start = 0.f;
+    left_placements.resize(1);
+    right_placements.resize(1);
+    evaluators.left(settings, cache, &start, 1, left_placements.data());
+    evaluators.right(settings, cache, &start, 1, right_placements.data());
+  }
 
-  std::vector<scene_object_info> right_placements{
-      scene_object_info{{0.f, -100.f, 0.f}, {0.f, 0.f, 0.f}, {1.f, 1.f, 1.f}}};
+  inline void reset() { mesh = mesh_baker::bake_tool(height, radius); }
+};
 
-  api_agnostic_geometry geometry;
+// a milling program drawn as a polyline. The moves are uploaded once with
+// every level of detail, progress and the level only change the ranges
+// drawn.
+struct toolpath_view {
+  std::optional<compiled_toolpath> path;
+  toolpath_lod lod;
+  orientation_track orientation;
   glfw_impl::renderable api_renderable;
+  GLint model_location{-1};
+  GLint color_location{-1};
+
+  bool visible{true};
+  // moves executed so far, drawn in executed_color. The fraction is how far
+  // the tool got towards the next move.
+  float progress{0.f};
+  // the tool is mounted at the progress while no run animates it, slerped
+  // in the left viewport and turned by its rotary axes in the right one
+  bool mount_tool{false};
+  // progress the placements were last written for, negative when stale
+  float mounted_progress{-1.f};
+  // screen space error the decimated polyline may show, in pixels
+  float max_error_pixels{1.f};
+  math::vec4 executed_color{1.f, 0.6f, 0.f, 1.f};
+  math::vec4 remaining_color{0.f, 0.8f, 0.f, 1.f};
+  // programs are z up, the scene y up
+  math::mat4 model{math::vec4(1.f, 0.f, 0.f, 0.f),
+                   math::vec4(0.f, 0.f, -1.f, 0.f),
+                   math::vec4(0.f, 1.f, 0.f, 0.f),
+                   math::vec4(0.f, 0.f, 0.f, 1.f)};
+
+  // compiles or maps the program and uploads it, false when it cannot be
+  // read
+  bool load(const std::filesystem::path &program);
+
+  // move index and fraction of the tool at the progress
+  inline float tool_position() const {
+    return std::max(progress - 1.f, 0.f);
+  }
+};
 
+// the material block as a heightmap, cut along the loaded program as far as
+// its progress and uploaded once a frame
+struct stock_view {
+  material_block block;
+  heightmap map;
+  glfw_impl::heightmap_texture texture;
+  glfw_impl::heightmap_renderable api_renderable;
+  // model and viewport are filled in per viewport
+  glfw_impl::heightmap_draw draw;
+
+  bool visible{true};
+  // moves of the program cut into the map, the segments ending at them
+  std::size_t cut_moves{0};
+
+  // an uncut block, r16 spans its whole height
   inline void reset() {
-    geometry.vertices.clear();
-    geometry.indices.clear();
-    mock_data::buildVerticesSmooth(100, height, radius, geometry.vertices,
-                                   geometry.indices);
-    glfw_impl::fill_renderable(geometry.vertices, geometry.indices,
-                               api_renderable);
+    map = milling::make_heightmap(block);
+    texture.offset = 0.f;
+    texture.scale = block.size.z;
+    cut_moves = 0;
   }
 };
 
@@ -83,10 +199,20 @@ struct interpolator_scene {
   internal::model model;
   internal::scene_grid grid;
   internal::light light;
+  internal::toolpath_view toolpath;
+  internal::stock_view stock;
+  // per frame data of both viewports, camera, light, animated instances and
+  // the indirect draws
+  glfw_impl::stream_buffer stream;
+  // packed meshes of every object drawn with the model program
+  glfw_impl::mesh_arena arena;
 
   bool init();
+  void begin_frame();
+  void end_frame();
   void render(input_state &input, bool left = true);
-  void set_light_uniforms(input_state &input, glfw_impl::renderable &r);
+  void update_frame_uniforms(input_state &input, const math::mat4 &view,
+                             const math::mat4 &proj);
 };
 
 } // namespace pusn
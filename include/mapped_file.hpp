@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+namespace pusn {
+namespace utils {
+
+// read only view of a whole file mapped into memory, move only
+class mapped_file {
+public:
+  mapped_file() = default;
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+  mapped_file(mapped_file &&other) noexcept;
+  mapped_file &operator=(mapped_file &&other) noexcept;
+  ~mapped_file();
+
+  // nullopt when the file cannot be opened or mapped, an empty file maps to
+  // an empty view
+  static std::optional<mapped_file> open(const std::filesystem::path &path);
+
+  inline const char *data() const { return data_; }
+  inline std::size_t size() const { return size_; }
+  inline std::string_view view() const { return {data_, size_}; }
+
+private:
+  void reset();
+
+  const char *data_{nullptr};
+  std::size_t size_{0};
+#ifdef _WIN32
+  void *mapping_{nullptr};
+#endif
+};
+
+} // namespace utils
+} // namespace pusn
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+
+#include <math.hpp>
+
+namespace math {
+
+// model matrix of an instance as the three rows of its affine 3x4 part,
+// followed by the rows of the normal matrix. The layout matches a std430
+// array of { vec4 model[3]; vec4 normal[3]; } on the gpu.
+struct affine_transform {
+  vec4 model[3];
+  vec4 normal[3];
+};
+
+namespace detail {
+
+// rows of the rotation matrix of a unit quaternion
+inline void rotation_rows(const glm::quat &q, vec3 &r0, vec3 &r1, vec3 &r2) {
+  const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+  const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+  const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+  r0 = vec3(1.f - 2.f * (yy + zz), 2.f * (xy - wz), 2.f * (xz + wy));
+  r1 = vec3(2.f * (xy + wz), 1.f - 2.f * (xx + zz), 2.f * (yz - wx));
+  r2 = vec3(2.f * (xz - wy), 2.f * (yz + wx), 1.f - 2.f * (xx + yy));
+}
+
+} // namespace detail
+
+// writes translate(position) * scale(scale) * rotate(rotation) for every
+// placement, Placement needs position, rotation (unit quaternion) and scale
+// members. The rotation goes straight from the quaternion to the matrix, the
+// normal matrix (M^-1)^T of the 3x3 part is scale^-1 * rotate.
+template <typename Placement>
+inline void compose_affine_batch(const Placement *placements,
+                                 std::size_t count, affine_transform *out) {
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto &p = placements[i];
+    vec3 r0, r1, r2;
+    detail::rotation_rows(p.rotation, r0, r1, r2);
+
+    auto &o = out[i];
+    o.model[0] = vec4(r0 * p.scale.x, p.position.x);
+    o.model[1] = vec4(r1 * p.scale.y, p.position.y);
+    o.model[2] = vec4(r2 * p.scale.z, p.position.z);
+    o.normal[0] = vec4(r0 / p.scale.x, 0.f);
+    o.normal[1] = vec4(r1 / p.scale.y, 0.f);
+    o.normal[2] = vec4(r2 / p.scale.z, 0.f);
+  }
+}
+
+} // namespace math
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include <math.hpp>
+#include <math/affine_batch.hpp>
+#include <math/spline.hpp>
+
+namespace math {
+
+// unit dual quaternion real + eps * dual of a rigid motion, for the rotation
+// r and the translation t the dual part is 0.5 * (0, t) * r
+struct dual_quat {
+  glm::quat real{1.f, 0.f, 0.f, 0.f};
+  glm::quat dual{0.f, 0.f, 0.f, 0.f};
+};
+
+inline dual_quat make_dual_quat(const glm::quat &rotation,
+                                const vec3 &translation) {
+  const glm::quat t(0.f, translation.x, translation.y, translation.z);
+  return {rotation, 0.5f * (t * rotation)};
+}
+
+inline dual_quat operator*(const dual_quat &a, const dual_quat &b) {
+  return {a.real * b.real, a.real * b.dual + a.dual * b.real};
+}
+
+inline dual_quat conjugate(const dual_quat &q) {
+  return {glm::conjugate(q.real), glm::conjugate(q.dual)};
+}
+
+inline vec3 translation(const dual_quat &q) {
+  const auto t = 2.f * (q.dual * glm::conjugate(q.real));
+  return {t.x, t.y, t.z};
+}
+
+// relative motion between two poses as a screw: rotation by angle about
+// direction combined with a slide by pitch along it, the screw axis passing
+// through the line with the given moment. Evaluating it at u is the ScLERP
+// from -> to, so the inverse trigonometry is paid once per pair of keys.
+struct screw {
+  dual_quat from;
+  vec3 direction{0.f, 0.f, 0.f};
+  vec3 moment{0.f, 0.f, 0.f};
+  float angle{0.f};
+  float pitch{0.f};
+};
+
+inline screw make_screw(const dual_quat &from, dual_quat to) {
+  // keep both poses in the same hemisphere so the motion takes the short way
+  if (glm::dot(from.real, to.real) < 0.f) {
+    to.real = -to.real;
+    to.dual = -to.dual;
+  }
+  const auto diff = conjugate(from) * to;
+  const vec3 v{diff.real.x, diff.real.y, diff.real.z};
+  const vec3 d{diff.dual.x, diff.dual.y, diff.dual.z};
+
+  screw s;
+  s.from = from;
+  const float sin_half = glm::length(v);
+  if (sin_half <= std::numeric_limits<float>::epsilon()) {
+    // pure translation, the slide runs along the translation itself
+    const auto t = translation(diff);
+    s.pitch = glm::length(t);
+    if (s.pitch > 0.f) {
+      s.direction = t / s.pitch;
+    }
+    return s;
+  }
+  s.angle = 2.f * std::atan2(sin_half, diff.real.w);
+  s.direction = v / sin_half;
+  s.pitch = -2.f * diff.dual.w / sin_half;
+  s.moment = (d - s.direction * (0.5f * s.pitch * diff.real.w)) / sin_half;
+  return s;
+}
+
+inline dual_quat evaluate(const screw &s, float u) {
+  const float half_angle = 0.5f * u * s.angle;
+  const float half_pitch = 0.5f * u * s.pitch;
+  const float sin_half = std::sin(half_angle);
+  const float cos_half = std::cos(half_angle);
+
+  const vec3 real = sin_half * s.direction;
+  const vec3 dual =
+      sin_half * s.moment + (half_pitch * cos_half) * s.direction;
+  return s.from * dual_quat{glm::quat(cos_half, real.x, real.y, real.z),
+                            glm::quat(-half_pitch * sin_half, dual.x, dual.y,
+                                      dual.z)};
+}
+
+// screw linear interpolation, constant speed rigid motion along the screw
+inline dual_quat sclerp(const dual_quat &from, const dual_quat &to, float u) {
+  return evaluate(make_screw(from, to), u);
+}
+
+// dual quaternion linear blending, a normalized lerp of all eight components.
+// Not constant speed, but no trigonometry at all.
+inline dual_quat dlb(const dual_quat &from, const dual_quat &to, float u) {
+  const float sign = glm::dot(from.real, to.real) < 0.f ? -1.f : 1.f;
+  const float wa = 1.f - u;
+  const float wb = sign * u;
+  const glm::quat real = wa * from.real + wb * to.real;
+  const glm::quat dual = wa * from.dual + wb * to.dual;
+
+  const float inv_norm = 1.f / glm::length(real);
+  const glm::quat r = real * inv_norm;
+  // remove the component of the dual part that breaks dot(real, dual) == 0
+  const glm::quat d = dual * inv_norm - r * (glm::dot(r, dual) * inv_norm);
+  return {r, d};
+}
+
+// writes the affine transform of a unit dual quaternion, the rotation is
+// orthonormal so the normal matrix is the rotation itself
+inline void to_affine(const dual_quat &q, affine_transform &out) {
+  vec3 r0, r1, r2;
+  detail::rotation_rows(q.real, r0, r1, r2);
+  const auto t = translation(q);
+  out.model[0] = vec4(r0, t.x);
+  out.model[1] = vec4(r1, t.y);
+  out.model[2] = vec4(r2, t.z);
+  out.normal[0] = vec4(r0, 0.f);
+  out.normal[1] = vec4(r1, 0.f);
+  out.normal[2] = vec4(r2, 0.f);
+}
+
+namespace detail {
+
+inline void store_motion(dual_quat *out, std::size_t i, const dual_quat &q) {
+  out[i] = q;
+}
+
+inline void store_motion(affine_transform *out, std::size_t i,
+                         const dual_quat &q) {
+  to_affine(q, out[i]);
+}
+
+} // namespace detail
+
+// piecewise ScLERP over the precomputed segments, segment i spans global
+// parameters [i, i + 1] / segment_count. Out is either dual_quat, or
+// affine_transform to emit the matrices directly.
+template <typename Out>
+inline void sclerp_batch(const screw *segments, std::size_t segment_count,
+                         const float *t, std::size_t count, Out *out) {
+  for (std::size_t i = 0; i < count; ++i) {
+    float u;
+    const auto &s = segments[locate_segment(segment_count, t[i], u)];
+    detail::store_motion(out, i, evaluate(s, u));
+  }
+}
+
+// piecewise DLB between consecutive keys, see sclerp_batch
+template <typename Out>
+inline void dlb_batch(const dual_quat *keys, std::size_t key_count,
+                      const float *t, std::size_t count, Out *out) {
+  for (std::size_t i = 0; i < count; ++i) {
+    float u;
+    const auto k = locate_segment(key_count - 1, t[i], u);
+    detail::store_motion(out, i, dlb(keys[k], keys[k + 1], u));
+  }
+}
+
+} // namespace math
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <math.hpp>
+#include <math/simd.hpp>
+
+namespace math {
+
+// structure-of-arrays views over quaternion buffers, one stream per component
+struct quat_soa_ref {
+  float *w, *x, *y, *z;
+};
+
+struct quat_soa_cref {
+  const float *w, *x, *y, *z;
+};
+
+// single quaternion seen as a one element soa buffer
+inline quat_soa_ref soa_ref(glm::quat &q) { return {&q.w, &q.x, &q.y, &q.z}; }
+
+struct quat_soa {
+  std::vector<float> w, x, y, z;
+
+  inline void resize(std::size_t count) {
+    w.resize(count);
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+  }
+
+  inline std::size_t size() const { return w.size(); }
+
+  inline glm::quat get(std::size_t i) const {
+    return glm::quat(w[i], x[i], y[i], z[i]);
+  }
+
+  inline void set(std::size_t i, const glm::quat &q) {
+    w[i] = q.w;
+    x[i] = q.x;
+    y[i] = q.y;
+    z[i] = q.z;
+  }
+
+  inline quat_soa_ref ref() { return {w.data(), x.data(), y.data(), z.data()}; }
+  inline quat_soa_cref cref() const {
+    return {w.data(), x.data(), y.data(), z.data()};
+  }
+};
+
+namespace detail {
+
+inline glm::quat load_quat(quat_soa_cref q, std::size_t i) {
+  return glm::quat(q.w[i], q.x[i], q.y[i], q.z[i]);
+}
+
+inline void store_quat(quat_soa_ref q, std::size_t i, const glm::quat &v) {
+  q.w[i] = v.w;
+  q.x[i] = v.x;
+  q.y[i] = v.y;
+  q.z[i] = v.z;
+}
+
+// q^exponent for a unit quaternion q with q.w >= 0
+inline glm::quat rotor_power(const glm::quat &q, float exponent) {
+  const float sin_half = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z);
+  if (sin_half <= std::numeric_limits<float>::epsilon()) {
+    return glm::quat(1.f, 0.f, 0.f, 0.f);
+  }
+  const float half_angle = std::atan2(sin_half, q.w) * exponent;
+  const float axis_scale = std::sin(half_angle) / sin_half;
+  return glm::quat(std::cos(half_angle), q.x * axis_scale, q.y * axis_scale,
+                   q.z * axis_scale);
+}
+
+// scalar kernel over [first, count), the tail the vector path left
+template <typename ScalarKernel>
+inline void run_tail(quat_soa_cref from, quat_soa_cref to, const float *t,
+                     quat_soa_ref out, std::size_t first, std::size_t count,
+                     ScalarKernel &&scalar_kernel) {
+  for (std::size_t i = first; i < count; ++i) {
+    store_quat(out, i,
+               scalar_kernel(load_quat(from, i), load_quat(to, i), t[i]));
+  }
+}
+
+template <typename ScalarKernel>
+inline void run_tail(const glm::quat &from, const glm::quat &to,
+                     const float *t, quat_soa_ref out, std::size_t first,
+                     std::size_t count, ScalarKernel &&scalar_kernel) {
+  for (std::size_t i = first; i < count; ++i) {
+    store_quat(out, i, scalar_kernel(from, to, t[i]));
+  }
+}
+
+// the vector paths, see quat_lanes.hpp. A baseline build compiles them once
+// for each instruction set, the others once for the target.
+#if defined(MATH_SIMD_DISPATCH)
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))),            \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+namespace avx2 {
+using V = simd::f32x8;
+#include <math/quat_lanes.hpp>
+} // namespace avx2
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("sse4.1"))),              \
+                             apply_to = function)
+#else
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#endif
+namespace sse4 {
+using V = simd::f32x4;
+#include <math/quat_lanes.hpp>
+} // namespace sse4
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#elif defined(MATH_SIMD_LANES)
+namespace native {
+using V = simd::f32xN;
+#include <math/quat_lanes.hpp>
+} // namespace native
+#endif
+
+} // namespace detail
+
+// the vector path of name for the target or, in a baseline build, the best
+// one the cpu runs. Evaluates to where the scalar tail starts.
+#if defined(MATH_SIMD_DISPATCH)
+#define MATH_LANES(name, ...)                                                  \
+  (simd::runtime_isa == simd::isa::avx2   ? detail::avx2::name(__VA_ARGS__)    \
+   : simd::runtime_isa == simd::isa::sse4 ? detail::sse4::name(__VA_ARGS__)    \
+                                          : std::size_t{0})
+#elif defined(MATH_SIMD_LANES)
+#define MATH_LANES(name, ...) detail::native::name(__VA_ARGS__)
+#else
+#define MATH_LANES(name, ...) std::size_t{0}
+#endif
+
+// out[i] = slerp(from[i], to[i], t[i]), results are normalized
+inline void slerp_batch(quat_soa_cref from, quat_soa_cref to, const float *t,
+                        quat_soa_ref out, std::size_t count) {
+  const std::size_t first = MATH_LANES(slerp_batch, from, to, t, out, count);
+  detail::run_tail(from, to, t, out, first, count, math::slerp);
+}
+
+// out[i] = slerp(from, to, t[i]), used for frame strips of a single motion
+inline void slerp_batch(const glm::quat &from, const glm::quat &to,
+                        const float *t, quat_soa_ref out, std::size_t count) {
+  const std::size_t first = MATH_LANES(slerp_batch, from, to, t, out, count);
+  detail::run_tail(from, to, t, out, first, count, math::slerp);
+}
+
+// out[i] = fast_slerp(from[i], to[i], t[i]), results are normalized
+inline void fast_slerp_batch(quat_soa_cref from, quat_soa_cref to,
+                             const float *t, quat_soa_ref out,
+                             std::size_t count) {
+  const std::size_t first =
+      MATH_LANES(fast_slerp_batch, from, to, t, out, count);
+  detail::run_tail(from, to, t, out, first, count, math::fast_slerp);
+}
+
+inline void fast_slerp_batch(const glm::quat &from, const glm::quat &to,
+                             const float *t, quat_soa_ref out,
+                             std::size_t count) {
+  const std::size_t first =
+      MATH_LANES(fast_slerp_batch, from, to, t, out, count);
+  detail::run_tail(from, to, t, out, first, count, math::fast_slerp);
+}
+
+// out[i] = lerp(from[i], to[i], t[i]), results are normalized
+inline void lerp_batch(quat_soa_cref from, quat_soa_cref to, const float *t,
+                       quat_soa_ref out, std::size_t count) {
+  const std::size_t first = MATH_LANES(lerp_batch, from, to, t, out, count);
+  detail::run_tail(from, to, t, out, first, count, math::lerp);
+}
+
+inline void lerp_batch(const glm::quat &from, const glm::quat &to,
+                       const float *t, quat_soa_ref out, std::size_t count) {
+  const std::size_t first = MATH_LANES(lerp_batch, from, to, t, out, count);
+  detail::run_tail(from, to, t, out, first, count, math::lerp);
+}
+
+// slerp(from, to, i / (count - 1)) for every i in [0, count). With uniform
+// spacing each sample is the previous one times a constant delta rotation, so
+// the strip costs one quaternion product per frame instead of a full slerp.
+// Consecutive samples run as independent recurrences in the vector lanes
+// (lane j steps by delta^width), samples are renormalized every few steps and
+// the lanes restart from exact slerp samples every anchor_steps steps, which
+// keeps the float drift below 3e-5 rad for arbitrarily long strips.
+inline void slerp_strip(const glm::quat &from, const glm::quat &to,
+                        quat_soa_ref out, std::size_t count) {
+  // counted in recurrence steps of a single lane
+  constexpr std::size_t renormalize_steps = 8;
+  constexpr std::size_t anchor_steps = 128;
+
+  if (count == 0) {
+    return;
+  }
+  if (count == 1) {
+    detail::store_quat(out, 0, from);
+    return;
+  }
+
+  const glm::quat z = glm::dot(from, to) < 0.f ? -to : to;
+  const float inv_steps = 1.f / static_cast<float>(count - 1);
+  const glm::quat relative = glm::conjugate(from) * z;
+
+  std::size_t i = MATH_LANES(slerp_strip, from, z, relative, inv_steps,
+                             anchor_steps, renormalize_steps, out, count);
+  if (i == 0) {
+    // no vector path, or fewer samples than lanes
+    const glm::quat delta = detail::rotor_power(relative, inv_steps);
+    glm::quat current = from;
+    for (; i < count; ++i) {
+      if (i % anchor_steps == 0) {
+        current = math::slerp(from, z, static_cast<float>(i) * inv_steps);
+      } else {
+        current = current * delta;
+        if (i % renormalize_steps == 0) {
+          current = glm::normalize(current);
+        }
+      }
+      detail::store_quat(out, i, current);
+    }
+  }
+  for (; i < count; ++i) {
+    detail::store_quat(out, i,
+                       math::slerp(from, z, static_cast<float>(i) * inv_steps));
+  }
+}
+
+#undef MATH_LANES
+
+} // namespace math
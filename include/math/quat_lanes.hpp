@@ -0,0 +1,237 @@
+// no include guard, quat_batch.hpp includes this once per instruction set,
+// each time in a namespace of its own that defines the vector type V. Under
+// runtime dispatch every function here is compiled for that instruction set
+// alone, so the vectors never cross into code built for another one.
+
+// sin(x) for x in [0, pi/2], odd taylor polynomial, |error| < 6e-8
+inline V sin_half_pi(V x) {
+  using namespace simd;
+  const V x2 = x * x;
+  V p = V::broadcast(-2.5052108e-8f);
+  p = fmadd(p, x2, V::broadcast(2.7557319e-6f));
+  p = fmadd(p, x2, V::broadcast(-1.9841270e-4f));
+  p = fmadd(p, x2, V::broadcast(8.3333333e-3f));
+  p = fmadd(p, x2, V::broadcast(-1.6666667e-1f));
+  p = fmadd(p, x2, V::broadcast(1.f));
+  return p * x;
+}
+
+// acos(x) for x in [0, 1] (Abramowitz & Stegun 4.4.46), |error| < 2e-8
+inline V acos_unit(V x) {
+  using namespace simd;
+  V p = V::broadcast(-0.0012624911f);
+  p = fmadd(p, x, V::broadcast(0.0066700901f));
+  p = fmadd(p, x, V::broadcast(-0.0170881256f));
+  p = fmadd(p, x, V::broadcast(0.0308918810f));
+  p = fmadd(p, x, V::broadcast(-0.0501743046f));
+  p = fmadd(p, x, V::broadcast(0.0889789874f));
+  p = fmadd(p, x, V::broadcast(-0.2145988016f));
+  p = fmadd(p, x, V::broadcast(1.5707963050f));
+  return sqrt(max(V::broadcast(0.f), V::broadcast(1.f) - x)) * p;
+}
+
+struct quat_lanes {
+  V w, x, y, z;
+
+  static inline quat_lanes load(quat_soa_cref q, std::size_t i) {
+    return {V::load(q.w + i), V::load(q.x + i), V::load(q.y + i),
+            V::load(q.z + i)};
+  }
+
+  static inline quat_lanes broadcast(const glm::quat &q) {
+    return {V::broadcast(q.w), V::broadcast(q.x), V::broadcast(q.y),
+            V::broadcast(q.z)};
+  }
+
+  inline void store(quat_soa_ref q, std::size_t i) const {
+    w.store(q.w + i);
+    x.store(q.x + i);
+    y.store(q.y + i);
+    z.store(q.z + i);
+  }
+};
+
+// shortest arc blend of a and b with per lane weights, normalized
+inline quat_lanes blend_normalized(const quat_lanes &a, const quat_lanes &b,
+                                   V wa, V wb) {
+  using namespace simd;
+  const V w = fmadd(wa, a.w, wb * b.w);
+  const V x = fmadd(wa, a.x, wb * b.x);
+  const V y = fmadd(wa, a.y, wb * b.y);
+  const V z = fmadd(wa, a.z, wb * b.z);
+  const V len = sqrt(fmadd(w, w, fmadd(x, x, fmadd(y, y, z * z))));
+  return {w / len, x / len, y / len, z / len};
+}
+
+inline quat_lanes normalize_lanes(const quat_lanes &a) {
+  const V one = V::broadcast(1.f);
+  return blend_normalized(a, a, one, V::broadcast(0.f));
+}
+
+// hamilton product a * b per lane
+inline quat_lanes mul_lanes(const quat_lanes &a, const quat_lanes &b) {
+  using namespace simd;
+  return {fmadd(a.w, b.w, V::broadcast(0.f) - fmadd(a.x, b.x,
+                                                    fmadd(a.y, b.y,
+                                                          a.z * b.z))),
+          fmadd(a.w, b.x, fmadd(a.x, b.w, a.y * b.z - a.z * b.y)),
+          fmadd(a.w, b.y, fmadd(a.y, b.w, a.z * b.x - a.x * b.z)),
+          fmadd(a.w, b.z, fmadd(a.z, b.w, a.x * b.y - a.y * b.x))};
+}
+
+inline V dot_lanes(const quat_lanes &a, const quat_lanes &b) {
+  using namespace simd;
+  return fmadd(a.w, b.w, fmadd(a.x, b.x, fmadd(a.y, b.y, a.z * b.z)));
+}
+
+// lane-wise equivalent of math::slerp, t is expected in [0, 1]
+inline quat_lanes slerp_lanes(const quat_lanes &a, quat_lanes b, V t) {
+  using namespace simd;
+  V cos_theta = dot_lanes(a, b);
+  const V flip = less(cos_theta, V::broadcast(0.f));
+  b = {negate_if(flip, b.w), negate_if(flip, b.x), negate_if(flip, b.y),
+       negate_if(flip, b.z)};
+  cos_theta = min(abs(cos_theta), V::broadcast(1.f));
+
+  const V one = V::broadcast(1.f);
+  const V theta = acos_unit(cos_theta);
+  // the common 1 / sin(theta) factor cancels out in the normalization
+  const V slerp_a = sin_half_pi((one - t) * theta);
+  const V slerp_b = sin_half_pi(t * theta);
+
+  const V use_slerp = less(
+      cos_theta, V::broadcast(1.f - std::numeric_limits<float>::epsilon()));
+  return blend_normalized(a, b, select(use_slerp, slerp_a, one - t),
+                          select(use_slerp, slerp_b, t));
+}
+
+// lane-wise equivalent of math::fast_slerp
+inline quat_lanes fast_slerp_lanes(const quat_lanes &a, quat_lanes b, V t) {
+  using namespace simd;
+  namespace c = fast_slerp_coefficients;
+  V cos_theta = dot_lanes(a, b);
+  const V flip = less(cos_theta, V::broadcast(0.f));
+  b = {negate_if(flip, b.w), negate_if(flip, b.x), negate_if(flip, b.y),
+       negate_if(flip, b.z)};
+
+  const V one = V::broadcast(1.f);
+  const V cos_m1 = abs(cos_theta) - one;
+  const V d = one - t;
+  const V sqr_t = t * t;
+  const V sqr_d = d * d;
+
+  V f_t = one;
+  V f_d = one;
+  for (int i = 7; i >= 0; --i) {
+    const V u = V::broadcast(c::u[i]);
+    const V v = V::broadcast(c::v[i]);
+    f_t = fmadd((u * sqr_t - v) * cos_m1, f_t, one);
+    f_d = fmadd((u * sqr_d - v) * cos_m1, f_d, one);
+  }
+
+  return blend_normalized(a, b, d * f_d, t * f_t);
+}
+
+inline quat_lanes lerp_lanes(const quat_lanes &a, quat_lanes b, V t) {
+  using namespace simd;
+  const V flip = less(dot_lanes(a, b), V::broadcast(0.f));
+  b = {negate_if(flip, b.w), negate_if(flip, b.x), negate_if(flip, b.y),
+       negate_if(flip, b.z)};
+  return blend_normalized(a, b, V::broadcast(1.f) - t, t);
+}
+
+// the kernel over the full lanes of [0, count), returns where the scalar
+// tail starts
+template <typename Kernel>
+inline std::size_t run_lanes(quat_soa_cref from, quat_soa_cref to,
+                             const float *t, quat_soa_ref out,
+                             std::size_t count, Kernel kernel) {
+  std::size_t i = 0;
+  for (; i + V::width <= count; i += V::width) {
+    kernel(quat_lanes::load(from, i), quat_lanes::load(to, i),
+           V::load(t + i))
+        .store(out, i);
+  }
+  return i;
+}
+
+template <typename Kernel>
+inline std::size_t run_lanes(const glm::quat &from, const glm::quat &to,
+                             const float *t, quat_soa_ref out,
+                             std::size_t count, Kernel kernel) {
+  const auto from_lanes = quat_lanes::broadcast(from);
+  const auto to_lanes = quat_lanes::broadcast(to);
+  std::size_t i = 0;
+  for (; i + V::width <= count; i += V::width) {
+    kernel(from_lanes, to_lanes, V::load(t + i)).store(out, i);
+  }
+  return i;
+}
+
+// entry points of quat_batch.hpp, From is quat_soa_cref or glm::quat
+template <typename From>
+inline std::size_t slerp_batch(const From &from, const From &to,
+                               const float *t, quat_soa_ref out,
+                               std::size_t count) {
+  return run_lanes(from, to, t, out, count,
+                   [](const quat_lanes &a, const quat_lanes &b, V s) {
+                     return slerp_lanes(a, b, s);
+                   });
+}
+
+template <typename From>
+inline std::size_t fast_slerp_batch(const From &from, const From &to,
+                                    const float *t, quat_soa_ref out,
+                                    std::size_t count) {
+  return run_lanes(from, to, t, out, count,
+                   [](const quat_lanes &a, const quat_lanes &b, V s) {
+                     return fast_slerp_lanes(a, b, s);
+                   });
+}
+
+template <typename From>
+inline std::size_t lerp_batch(const From &from, const From &to,
+                              const float *t, quat_soa_ref out,
+                              std::size_t count) {
+  return run_lanes(from, to, t, out, count,
+                   [](const quat_lanes &a, const quat_lanes &b, V s) {
+                     return lerp_lanes(a, b, s);
+                   });
+}
+
+// vector part of math::slerp_strip, lane j steps by delta^width
+inline std::size_t slerp_strip(const glm::quat &from, const glm::quat &z,
+                               const glm::quat &relative, float inv_steps,
+                               std::size_t anchor_steps,
+                               std::size_t renormalize_steps,
+                               quat_soa_ref out, std::size_t count) {
+  const std::size_t anchor_interval = anchor_steps * V::width;
+  const std::size_t renormalize_interval = renormalize_steps * V::width;
+
+  float lane_offsets[V::width];
+  for (std::size_t lane = 0; lane < V::width; ++lane) {
+    lane_offsets[lane] = static_cast<float>(lane);
+  }
+  const V lanes = V::load(lane_offsets);
+  const quat_lanes from_lanes = quat_lanes::broadcast(from);
+  const quat_lanes to_lanes = quat_lanes::broadcast(z);
+  const quat_lanes delta = quat_lanes::broadcast(
+      rotor_power(relative, static_cast<float>(V::width) * inv_steps));
+
+  quat_lanes current = from_lanes;
+  std::size_t i = 0;
+  for (; i + V::width <= count; i += V::width) {
+    if (i % anchor_interval == 0) {
+      const V t = (V::broadcast(static_cast<float>(i)) + lanes) *
+                  V::broadcast(inv_steps);
+      current = slerp_lanes(from_lanes, to_lanes, t);
+    } else {
+      current = mul_lanes(current, delta);
+      if (i % renormalize_interval == 0) {
+        current = normalize_lanes(current);
+      }
+    }
+    current.store(out, i);
+  }
+  return i;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define MATH_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#define MATH_SIMD_SSE4
+#include <smmintrin.h>
+#elif defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+// a baseline x86-64 target, the vector paths are compiled for their own
+// instruction sets and the batch kernels pick one at startup
+#define MATH_SIMD_DISPATCH
+#include <immintrin.h>
+#endif
+
+#if defined(MATH_SIMD_AVX2) || defined(MATH_SIMD_SSE4) ||                     \
+    defined(MATH_SIMD_DISPATCH)
+#define MATH_SIMD_LANES
+#endif
+
+#if defined(MATH_SIMD_DISPATCH)
+#define MATH_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define MATH_TARGET_SSE4 __attribute__((target("sse4.1")))
+#else
+#define MATH_TARGET_AVX2
+#define MATH_TARGET_SSE4
+#endif
+
+// thin wrappers over the vector registers so that the batch kernels can be
+// written once and compiled for whatever the target supports
+namespace math {
+namespace simd {
+
+#if defined(MATH_SIMD_AVX2) || defined(MATH_SIMD_DISPATCH)
+struct f32x8 {
+  static constexpr std::size_t width = 8;
+  __m256 v;
+
+  MATH_TARGET_AVX2 static inline f32x8 load(const float *p) {
+    return {_mm256_loadu_ps(p)};
+  }
+  MATH_TARGET_AVX2 static inline f32x8 broadcast(float s) {
+    return {_mm256_set1_ps(s)};
+  }
+  MATH_TARGET_AVX2 inline void store(float *p) const {
+    _mm256_storeu_ps(p, v);
+  }
+};
+
+MATH_TARGET_AVX2 inline f32x8 operator+(f32x8 a, f32x8 b) {
+  return {_mm256_add_ps(a.v, b.v)};
+}
+MATH_TARGET_AVX2 inline f32x8 operator-(f32x8 a, f32x8 b) {
+  return {_mm256_sub_ps(a.v, b.v)};
+}
+MATH_TARGET_AVX2 inline f32x8 operator*(f32x8 a, f32x8 b) {
+  return {_mm256_mul_ps(a.v, b.v)};
+}
+MATH_TARGET_AVX2 inline f32x8 operator/(f32x8 a, f32x8 b) {
+  return {_mm256_div_ps(a.v, b.v)};
+}
+// a * b + c
+MATH_TARGET_AVX2 inline f32x8 fmadd(f32x8 a, f32x8 b, f32x8 c) {
+  return {_mm256_fmadd_ps(a.v, b.v, c.v)};
+}
+MATH_TARGET_AVX2 inline f32x8 sqrt(f32x8 a) { return {_mm256_sqrt_ps(a.v)}; }
+MATH_TARGET_AVX2 inline f32x8 min(f32x8 a, f32x8 b) {
+  return {_mm256_min_ps(a.v, b.v)};
+}
+MATH_TARGET_AVX2 inline f32x8 max(f32x8 a, f32x8 b) {
+  return {_mm256_max_ps(a.v, b.v)};
+}
+// lane mask, all bits set where a < b
+MATH_TARGET_AVX2 inline f32x8 less(f32x8 a, f32x8 b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)};
+}
+// picks a where mask is set, b elsewhere
+MATH_TARGET_AVX2 inline f32x8 select(f32x8 mask, f32x8 a, f32x8 b) {
+  return {_mm256_blendv_ps(b.v, a.v, mask.v)};
+}
+// flips the sign of a where mask is set
+MATH_TARGET_AVX2 inline f32x8 negate_if(f32x8 mask, f32x8 a) {
+  return {_mm256_xor_ps(a.v, _mm256_and_ps(mask.v, _mm256_set1_ps(-0.f)))};
+}
+MATH_TARGET_AVX2 inline f32x8 abs(f32x8 a) {
+  return {_mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v)};
+}
+#endif
+
+#if defined(MATH_SIMD_LANES)
+struct f32x4 {
+  static constexpr std::size_t width = 4;
+  __m128 v;
+
+  MATH_TARGET_SSE4 static inline f32x4 load(const float *p) {
+    return {_mm_loadu_ps(p)};
+  }
+  MATH_TARGET_SSE4 static inline f32x4 broadcast(float s) {
+    return {_mm_set1_ps(s)};
+  }
+  MATH_TARGET_SSE4 inline void store(float *p) const { _mm_storeu_ps(p, v); }
+};
+
+MATH_TARGET_SSE4 inline f32x4 operator+(f32x4 a, f32x4 b) {
+  return {_mm_add_ps(a.v, b.v)};
+}
+MATH_TARGET_SSE4 inline f32x4 operator-(f32x4 a, f32x4 b) {
+  return {_mm_sub_ps(a.v, b.v)};
+}
+MATH_TARGET_SSE4 inline f32x4 operator*(f32x4 a, f32x4 b) {
+  return {_mm_mul_ps(a.v, b.v)};
+}
+MATH_TARGET_SSE4 inline f32x4 operator/(f32x4 a, f32x4 b) {
+  return {_mm_div_ps(a.v, b.v)};
+}
+MATH_TARGET_SSE4 inline f32x4 fmadd(f32x4 a, f32x4 b, f32x4 c) {
+  return a * b + c;
+}
+MATH_TARGET_SSE4 inline f32x4 sqrt(f32x4 a) { return {_mm_sqrt_ps(a.v)}; }
+MATH_TARGET_SSE4 inline f32x4 min(f32x4 a, f32x4 b) {
+  return {_mm_min_ps(a.v, b.v)};
+}
+MATH_TARGET_SSE4 inline f32x4 max(f32x4 a, f32x4 b) {
+  return {_mm_max_ps(a.v, b.v)};
+}
+MATH_TARGET_SSE4 inline f32x4 less(f32x4 a, f32x4 b) {
+  return {_mm_cmplt_ps(a.v, b.v)};
+}
+MATH_TARGET_SSE4 inline f32x4 select(f32x4 mask, f32x4 a, f32x4 b) {
+  return {_mm_blendv_ps(b.v, a.v, mask.v)};
+}
+MATH_TARGET_SSE4 inline f32x4 negate_if(f32x4 mask, f32x4 a) {
+  return {_mm_xor_ps(a.v, _mm_and_ps(mask.v, _mm_set1_ps(-0.f)))};
+}
+MATH_TARGET_SSE4 inline f32x4 abs(f32x4 a) {
+  return {_mm_andnot_ps(_mm_set1_ps(-0.f), a.v)};
+}
+#endif
+
+// widest vector available for the current target, the batch kernels fall
+// back to the scalar code when neither AVX2 nor SSE4.1 is enabled
+#if defined(MATH_SIMD_AVX2)
+using f32xN = f32x8;
+#elif defined(MATH_SIMD_SSE4)
+using f32xN = f32x4;
+#endif
+
+#if defined(MATH_SIMD_DISPATCH)
+enum class isa { scalar, sse4, avx2 };
+
+inline isa detect_isa() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return isa::avx2;
+  }
+  return __builtin_cpu_supports("sse4.1") ? isa::sse4 : isa::scalar;
+}
+
+// best vector path of the cpu, picked once at startup
+inline const isa runtime_isa = detect_isa();
+#endif
+
+} // namespace simd
+} // namespace math
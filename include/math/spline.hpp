@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <math.hpp>
+
+namespace math {
+
+// maps global t in [0, 1] onto a segment index and the local parameter u
+inline std::size_t locate_segment(std::size_t segment_count, float t,
+                                  float &u) {
+  const float scaled =
+      std::clamp(t, 0.f, 1.f) * static_cast<float>(segment_count);
+  const auto segment = std::min(static_cast<std::size_t>(scaled),
+                                segment_count - 1);
+  u = scaled - static_cast<float>(segment);
+  return segment;
+}
+
+// logarithm of a unit quaternion, half angle times the rotation axis
+inline vec3 log_unit(const glm::quat &q) {
+  const vec3 v{q.x, q.y, q.z};
+  const float sin_half = glm::length(v);
+  if (sin_half <= std::numeric_limits<float>::epsilon()) {
+    return v;
+  }
+  return v * (std::atan2(sin_half, q.w) / sin_half);
+}
+
+// inverse of log_unit
+inline glm::quat exp_pure(const vec3 &v) {
+  const float half_angle = glm::length(v);
+  if (half_angle <= std::numeric_limits<float>::epsilon()) {
+    return glm::quat(1.f, v.x, v.y, v.z);
+  }
+  const auto axis = v * (std::sin(half_angle) / half_angle);
+  return glm::quat(std::cos(half_angle), axis.x, axis.y, axis.z);
+}
+
+// uniform catmull-rom spline through the keys, each segment is cached in
+// power form so that evaluation is a segment lookup and three fmas per
+// component. End tangents are one-sided, two keys give a straight line.
+template <typename T> struct catmull_rom_spline {
+  // p(u) = ((a * u + b) * u + c) * u + d
+  std::vector<std::array<T, 4>> segments;
+
+  inline void build(const std::vector<T> &keys) {
+    segments.clear();
+    if (keys.size() < 2) {
+      return;
+    }
+    const auto last = keys.size() - 1;
+    auto tangent = [&](std::size_t i) -> T {
+      if (i == 0) {
+        return keys[1] - keys[0];
+      }
+      if (i == last) {
+        return keys[last] - keys[last - 1];
+      }
+      return 0.5f * (keys[i + 1] - keys[i - 1]);
+    };
+
+    segments.reserve(last);
+    for (std::size_t i = 0; i < last; ++i) {
+      const T &p0 = keys[i];
+      const T &p1 = keys[i + 1];
+      const T m0 = tangent(i);
+      const T m1 = tangent(i + 1);
+      segments.push_back({2.f * (p0 - p1) + m0 + m1,
+                          3.f * (p1 - p0) - 2.f * m0 - m1, m0, p0});
+    }
+  }
+
+  inline bool empty() const { return segments.empty(); }
+
+  inline T evaluate(float t) const {
+    float u;
+    const auto &s = segments[locate_segment(segments.size(), t, u)];
+    return ((s[0] * u + s[1]) * u + s[2]) * u + s[3];
+  }
+};
+
+// SQUAD through unit quaternion keys. The intermediate control quaternions
+// s_i = q_i exp(-(log(q_i^-1 q_i+1) + log(q_i^-1 q_i-1)) / 4) are computed
+// once in build(), evaluation is then three calls to the blend function.
+struct squad_spline {
+  std::vector<glm::quat> keys;
+  std::vector<glm::quat> controls;
+
+  inline void build(const std::vector<glm::quat> &input) {
+    keys.clear();
+    controls.clear();
+    if (input.size() < 2) {
+      return;
+    }
+
+    // keep neighbouring keys in the same hemisphere
+    keys.reserve(input.size());
+    keys.push_back(glm::normalize(input.front()));
+    for (std::size_t i = 1; i < input.size(); ++i) {
+      const auto q = glm::normalize(input[i]);
+      keys.push_back(glm::dot(keys.back(), q) < 0.f ? -q : q);
+    }
+
+    const auto last = keys.size() - 1;
+    controls.reserve(keys.size());
+    controls.push_back(keys.front());
+    for (std::size_t i = 1; i < last; ++i) {
+      const auto inv = glm::conjugate(keys[i]);
+      const auto sum =
+          log_unit(inv * keys[i + 1]) + log_unit(inv * keys[i - 1]);
+      controls.push_back(glm::normalize(keys[i] * exp_pure(-0.25f * sum)));
+    }
+    controls.push_back(keys.back());
+  }
+
+  inline bool empty() const { return keys.size() < 2; }
+
+  // blend is one of math::slerp, math::fast_slerp or math::lerp
+  template <typename Blend>
+  inline glm::quat evaluate(float t, Blend &&blend) const {
+    float u;
+    const auto i = locate_segment(keys.size() - 1, t, u);
+    return blend(blend(keys[i], keys[i + 1], u),
+                 blend(controls[i], controls[i + 1], u), 2.f * u * (1.f - u));
+  }
+};
+
+// inverse arc-length table of a curve, maps the travelled fraction of its
+// length onto the curve parameter. The table is resampled at uniform length
+// fractions when built, so a lookup is one index computation and a lerp.
+struct arc_length_table {
+  // curve parameter at length fractions k / (parameters.size() - 1)
+  std::vector<float> parameters;
+  float length{0.f};
+
+  template <typename Curve>
+  inline void build(const Curve &curve, std::size_t samples = 1024) {
+    std::vector<float> cumulative(samples + 1, 0.f);
+    auto previous = curve(0.f);
+    for (std::size_t i = 1; i <= samples; ++i) {
+      const auto current = curve(static_cast<float>(i) / samples);
+      cumulative[i] = cumulative[i - 1] + glm::length(current - previous);
+      previous = current;
+    }
+    length = cumulative.back();
+
+    parameters.resize(samples + 1);
+    if (length <= std::numeric_limits<float>::epsilon()) {
+      for (std::size_t k = 0; k <= samples; ++k) {
+        parameters[k] = static_cast<float>(k) / samples;
+      }
+      return;
+    }
+
+    // cumulative is monotone, so one forward sweep inverts it
+    std::size_t j = 0;
+    for (std::size_t k = 0; k <= samples; ++k) {
+      const float target = length * static_cast<float>(k) / samples;
+      while (j + 1 < samples && cumulative[j + 1] < target) {
+        ++j;
+      }
+      const float span = cumulative[j + 1] - cumulative[j];
+      const float local =
+          span > 0.f ? std::clamp((target - cumulative[j]) / span, 0.f, 1.f)
+                     : 0.f;
+      parameters[k] = (static_cast<float>(j) + local) / samples;
+    }
+  }
+
+  inline bool empty() const { return parameters.size() < 2; }
+
+  // curve parameter after travelling the fraction s of the whole length
+  inline float parameter(float s) const {
+    float u;
+    const auto i = locate_segment(parameters.size() - 1, s, u);
+    return glm::mix(parameters[i], parameters[i + 1], u);
+  }
+};
+
+} // namespace math
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include <geometry.hpp>
+
+namespace pusn {
+
+// one level of detail inside the shared index buffer of a baked mesh
+struct mesh_lod {
+  int sectors{0};
+  std::size_t first_index{0};
+  std::size_t index_count{0};
+};
+
+// every level of a parametric mesh in one vertex and index buffer, the
+// finest level first
+struct baked_mesh {
+  api_agnostic_geometry geometry;
+  std::vector<mesh_lod> lods;
+  // radius of the round parts and of a sphere bounding the whole mesh
+  float radius{0.f};
+  float bounding_radius{0.f};
+
+  // coarsest level whose sector edges stay below max_edge_pixels when the
+  // round parts cover projected_radius pixels
+  const mesh_lod &select_lod(float projected_radius,
+                             float max_edge_pixels = 4.f) const;
+};
+
+namespace mesh_baker {
+
+// sector counts baked for the tool, finest first
+inline constexpr int tool_lod_sectors[] = {100, 48, 24, 12};
+
+// the tool of mock_data::buildVerticesSmooth at every tool_lod_sectors count.
+// The result is cached in cache_dir under a name derived from the parameters
+// and loaded from there on later runs.
+baked_mesh bake_tool(float height, float radius,
+                     const std::filesystem::path &cache_dir = "cache");
+
+} // namespace mesh_baker
+} // namespace pusn
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+#include <compiled_toolpath.hpp>
+#include <heightmap.hpp>
+#include <math.hpp>
+#include <tool_orientation.hpp>
+#include <toolpath.hpp>
+
+namespace pusn {
+
+struct material_block {
+  // centered on the program origin, the bottom at z = 0
+  math::vec3 size{150.f, 150.f, 50.f};
+  int resolution_x{2048};
+  int resolution_y{2048};
+};
+
+namespace milling {
+
+heightmap make_heightmap(const material_block &block);
+
+// removes the material swept by the tool along the segments ending at the
+// moves [first, last) of path, the z of a move is the tip of the tool.
+// Tiles are cut in parallel, each with the segments crossing it, and marked
+// dirty.
+heightmap_region cut(heightmap &map, const tool_info &tool,
+                     const compiled_toolpath &path, std::size_t first,
+                     std::size_t last);
+
+// the same for a 5 axis program, the ball's centre sits a radius along the
+// tool axis from the tip, the axis turning between the moves by method.
+// Segments turning the axis are split until the centre's path stays within
+// half a cell. A flat end is cut upright as by the overload above.
+heightmap_region cut(heightmap &map, const tool_info &tool,
+                     const compiled_toolpath &path,
+                     const orientation_track &orientation,
+                     orientation_method method, std::size_t first,
+                     std::size_t last);
+
+} // namespace milling
+} // namespace pusn
@@ -13,6 +13,7 @@ inline std::vector<float> getUnitCircleVertices(int SectorCount) {
   float sectorAngle; // radian
 
   std::vector<float> unitCircleVertices;
+  unitCircleVertices.reserve(3 * (SectorCount + 1));
   for (int i = 0; i <= SectorCount; ++i) {
     sectorAngle = i * sectorStep;
     unitCircleVertices.push_back(cos(sectorAngle)); // x
@@ -28,17 +29,19 @@ inline void build_vertices_helper(int SectorCount, float Height, float Radius,
                                   const math::mat4 &transform,
                                   math::vec3 default_color = {1.f, 0.f, 0.f}) {
   const auto initial_idx = vertices.size();
-  // clear memory of prev arrays
-  std::vector<float> normals;
-  std::vector<float> texCoords;
+  // 2 rings of side vertices, 2 caps of center + ring, 12 indices per sector
+  vertices.reserve(vertices.size() + 4 * (SectorCount + 1));
+  indices.reserve(indices.size() + 12 * SectorCount);
 
   // get unit circle vectors on XY-plane
   std::vector<float> unitVertices = getUnitCircleVertices(SectorCount);
 
-  auto transformer = [=](const pusn::pos_norm_col &in) -> pusn::pos_norm_col {
+  // the same for every vertex, compute it once
+  const math::mat3 normal_transform =
+      glm::mat3(glm::inverse(glm::transpose(transform)));
+  auto transformer = [&](const pusn::pos_norm_col &in) -> pusn::pos_norm_col {
     return {glm::vec3(transform * glm::vec4{in.pos, 1.f}),
-            glm::mat3(glm::inverse(glm::transpose(transform))) * in.normal,
-            in.color};
+            normal_transform * in.normal, in.color};
   };
 
   // put side vertices to arrays
@@ -57,7 +60,8 @@ inline void build_vertices_helper(int SectorCount, float Height, float Radius,
     }
   }
 
-  int baseCenterIndex = (int)vertices.size();
+  // relative to initial_idx like the other indices below
+  int baseCenterIndex = (int)(vertices.size() - initial_idx);
   int topCenterIndex =
       baseCenterIndex + SectorCount + 1; // include center vertex
 
@@ -79,44 +83,44 @@ inline void build_vertices_helper(int SectorCount, float Height, float Radius,
                        {0, 0, nz},
                        default_color}));
     }
+  }
 
-    int k1 = 0;
-    int k2 = SectorCount + 1;
+  int k1 = 0;
+  int k2 = SectorCount + 1;
 
-    for (int i = 0; i < SectorCount; ++i, ++k1, ++k2) {
-      indices.push_back(k1 + initial_idx);
-      indices.push_back(k1 + 1 + initial_idx);
-      indices.push_back(k2 + initial_idx);
+  for (int i = 0; i < SectorCount; ++i, ++k1, ++k2) {
+    indices.push_back(k1 + initial_idx);
+    indices.push_back(k1 + 1 + initial_idx);
+    indices.push_back(k2 + initial_idx);
 
-      indices.push_back(k2 + initial_idx);
-      indices.push_back(k1 + 1 + initial_idx);
-      indices.push_back(k2 + 1 + initial_idx);
-    }
+    indices.push_back(k2 + initial_idx);
+    indices.push_back(k1 + 1 + initial_idx);
+    indices.push_back(k2 + 1 + initial_idx);
+  }
 
-    for (int i = 0, k = baseCenterIndex + 1; i < SectorCount; ++i, ++k) {
-      if (i < SectorCount - 1) {
-        indices.push_back(baseCenterIndex + initial_idx);
-        indices.push_back(k + 1 + initial_idx);
-        indices.push_back(k + initial_idx);
-      } else // last triangle
-      {
-        indices.push_back(baseCenterIndex + initial_idx);
-        indices.push_back(baseCenterIndex + 1 + initial_idx);
-        indices.push_back(k + initial_idx);
-      }
+  for (int i = 0, k = baseCenterIndex + 1; i < SectorCount; ++i, ++k) {
+    if (i < SectorCount - 1) {
+      indices.push_back(baseCenterIndex + initial_idx);
+      indices.push_back(k + 1 + initial_idx);
+      indices.push_back(k + initial_idx);
+    } else // last triangle
+    {
+      indices.push_back(baseCenterIndex + initial_idx);
+      indices.push_back(baseCenterIndex + 1 + initial_idx);
+      indices.push_back(k + initial_idx);
     }
+  }
 
-    for (int i = 0, k = topCenterIndex + 1; i < SectorCount; ++i, ++k) {
-      if (i < SectorCount - 1) {
-        indices.push_back(topCenterIndex + initial_idx);
-        indices.push_back(k + initial_idx);
-        indices.push_back(k + 1 + initial_idx);
-      } else // last triangle
-      {
-        indices.push_back(topCenterIndex + initial_idx);
-        indices.push_back(k + initial_idx);
-        indices.push_back(topCenterIndex + 1 + initial_idx);
-      }
+  for (int i = 0, k = topCenterIndex + 1; i < SectorCount; ++i, ++k) {
+    if (i < SectorCount - 1) {
+      indices.push_back(topCenterIndex + initial_idx);
+      indices.push_back(k + initial_idx);
+      indices.push_back(k + 1 + initial_idx);
+    } else // last triangle
+    {
+      indices.push_back(topCenterIndex + initial_idx);
+      indices.push_back(k + initial_idx);
+      indices.push_back(topCenterIndex + 1 + initial_idx);
     }
   }
 }
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <compiled_toolpath.hpp>
+#include <math.hpp>
+#include <math/quat_batch.hpp>
+
+namespace pusn {
+
+enum class orientation_method : std::uint8_t { slerp, euler };
+
+// rotations taking +z to the tool axis of every move of a program, as
+// rotate_y(b) * rotate_x(a), the rotary axes of the machine. Between two
+// moves the rotation is either slerped or the angles are blended, the way a
+// real head turns its axes.
+struct orientation_track {
+  // consecutive rotations lie in the same hemisphere
+  math::quat_soa rotations;
+  // (a, b, 0) per move, b unwrapped so every move turns the shorter way
+  std::vector<math::vec3> euler;
+
+  inline std::size_t size() const { return rotations.size(); }
+  inline bool empty() const { return rotations.size() == 0; }
+
+  // from the tool axes of path, +z throughout for 3 axis programs
+  void build(const compiled_toolpath &path);
+
+  // rotations at s[i], a move index and the fraction of the way to the next
+  // one, clamped to the moves of the track
+  void evaluate_batch(orientation_method method, const float *s,
+                      std::size_t count, math::quat_soa_ref out) const;
+};
+
+// rotation of +z onto the unit axis, gimbal locked axes keep previous_b
+math::vec3 axis_to_euler(const math::vec3 &axis, float previous_b = 0.f);
+
+// the image of +z under q
+inline math::vec3 tool_axis(const glm::quat &q) {
+  return {2.f * (q.x * q.z + q.w * q.y), 2.f * (q.y * q.z - q.w * q.x),
+          1.f - 2.f * (q.x * q.x + q.y * q.y)};
+}
+
+} // namespace pusn
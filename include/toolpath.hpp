@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace pusn {
+
+enum class tool_type : std::uint8_t { ball, flat };
+
+// cutter of a program, encoded in its extension: k16 is a 16 mm ball end,
+// f10 a 10 mm flat end
+struct tool_info {
+  tool_type type{tool_type::ball};
+  float diameter{0.f};
+};
+
+// moves of a milling program, one entry per line that moves the tool. The
+// coordinates are absolute, axes a line leaves out keep their last value.
+struct toolpath {
+  tool_info tool;
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  // the N word of the line, or its position in the file when it has none
+  std::vector<std::uint32_t> line;
+  // unit tool axis of every move, from the tip towards the spindle. Only
+  // filled for 5 axis programs, the axis is +z otherwise.
+  std::vector<float> i;
+  std::vector<float> j;
+  std::vector<float> k;
+
+  inline std::size_t size() const { return x.size(); }
+  inline bool empty() const { return x.empty(); }
+  inline bool has_orientation() const { return !i.empty(); }
+  inline void reserve(std::size_t count) {
+    x.reserve(count);
+    y.reserve(count);
+    z.reserve(count);
+    line.reserve(count);
+  }
+  inline void clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    line.clear();
+    i.clear();
+    j.clear();
+    k.clear();
+  }
+};
+
+namespace toolpath_parser {
+
+std::optional<tool_info> decode_tool(const std::filesystem::path &path);
+
+// appends the G00/G01 moves of text to out, false and a logged error on the
+// first malformed line. The tool axis of a move is given either as a vector
+// by I, J and K or by the rotary axes A and B in degrees, the axis then being
+// rotate_y(B) * rotate_x(A) * +z.
+bool parse(std::string_view text, toolpath &out);
+
+// maps the program and parses it, the tool comes from the extension
+std::optional<toolpath> load(const std::filesystem::path &path);
+
+} // namespace toolpath_parser
+} // namespace pusn
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <compiled_toolpath.hpp>
+
+namespace pusn {
+
+// one decimation of a toolpath, a range of toolpath_lod::indices. No
+// dropped move lies farther than tolerance from the polyline kept.
+struct polyline_lod {
+  float tolerance{0.f};
+  std::size_t first_index{0};
+  std::size_t index_count{0};
+};
+
+// nested Douglas-Peucker decimations of a toolpath, all in one index buffer
+// over the path's moves. Indices increase within a level, so the part of a
+// level up to a move is a prefix of its range.
+struct toolpath_lod {
+  std::vector<std::uint32_t> indices;
+  // every move first, then growing tolerances
+  std::vector<polyline_lod> levels;
+
+  // coarsest level whose tolerance stays below max_error
+  const polyline_lod &select(float max_error) const;
+  // indices of level reaching no further than move
+  std::size_t prefix(const polyline_lod &level, std::size_t move) const;
+};
+
+namespace toolpath_decimation {
+
+// levels at base_tolerance * ratio^k until a level keeps fewer than
+// min_vertices moves
+toolpath_lod build(const compiled_toolpath &path, float base_tolerance = 0.01f,
+                   float ratio = 4.f, std::size_t min_vertices = 256);
+
+} // namespace toolpath_decimation
+} // namespace pusn
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <geometry.hpp>
+#include <math/dual_quat.hpp>
+#include <math/quat_batch.hpp>
+#include <math/spline.hpp>
+
+namespace pusn {
+
+namespace internal {
+
+// pose the trajectory passes through between the start and the end pose
+struct keyframe {
+  math::vec3 position{0.f, 0.f, 0.f};
+  glm::quat quat_rotation{1.f, 0.f, 0.f, 0.f};
+  glm::vec3 euler_rotation{0.f, 0.f, 0.f};
+};
+
+struct simulation_settings {
+  float length{5.f};
+  decltype(std::chrono::system_clock::now()) start_time;
+  math::vec3 position_start{0.f, 0.f, 0.f};
+  math::vec3 position_end{500.f, 0.f, 0.f};
+
+  glm::quat quat_rotation_start{1.f, 0.f, 0.f, 0.f};
+  glm::quat quat_rotation_end{1.f, 0.f, 0.f, 0.f};
+
+  glm::vec3 euler_rotation_start{0.f, 0.f, 0.f};
+  glm::vec3 euler_rotation_end{2 * glm::pi<float>(), 0.f, 0.f};
+
+  // intermediate keys, empty for a plain start to end motion
+  std::vector<keyframe> keyframes;
+  // move along the keyframed path with constant speed
+  bool constant_speed{true};
+
+  bool slerp{true};
+  // polynomial approximation of slerp, see math::fast_slerp
+  bool fast_slerp{false};
+  // interpolate position and rotation together as one dual quaternion,
+  // with ScLERP when screw is set and DLB otherwise
+  bool dual_quaternion{false};
+  bool screw{true};
+  bool animation{true};
+  int frames{10};
+};
+
+// start to end euler angles motion with the wrapping around resolved up front,
+// each axis takes the shorter way and a sample is one fma per axis
+struct euler_plan {
+  math::vec3 start{0.f, 0.f, 0.f};
+  math::vec3 delta{0.f, 0.f, 0.f};
+
+  inline void build(const glm::vec3 &euler_start, const glm::vec3 &euler_end) {
+    const float pi = glm::pi<float>();
+    const float tau = 2 * glm::pi<float>();
+
+    for (int axis = 0; axis < 3; ++axis) {
+      float eu_st = std::fmod(euler_start[axis], tau);
+      float eu_en = std::fmod(euler_end[axis], tau);
+      if (std::abs(eu_en - eu_st) > pi) {
+        if (eu_en > eu_st) {
+          eu_st += tau;
+        } else {
+          eu_en += tau;
+        }
+      }
+      start[axis] = eu_st;
+      delta[axis] = eu_en - eu_st;
+    }
+  }
+
+  inline math::vec3 evaluate(float t) const { return start + t * delta; }
+
+  inline void evaluate_batch(const float *t, std::size_t count,
+                             math::vec3 *out) const {
+    for (std::size_t i = 0; i < count; ++i) {
+      out[i] = start + t[i] * delta;
+    }
+  }
+};
+
+// data derived from the settings of a run, built once when the simulation
+// starts so that every frame only does a segment lookup and a blend
+struct trajectory_cache {
+  euler_plan euler;
+
+  // splines through start, keyframes and end
+  math::catmull_rom_spline<math::vec3> position;
+  math::squad_spline rotation;
+  math::catmull_rom_spline<math::vec3> euler_rotation;
+  // rigid motion keys and the screws between consecutive ones
+  std::vector<math::dual_quat> motions;
+  std::vector<math::screw> screws;
+  // reparameterizes all channels by the arc length of the position spline
+  std::optional<math::arc_length_table> arc_length;
+
+  void build(const simulation_settings &settings);
+
+  // spline parameter reached after the given fraction of the run time
+  inline float parameter(float progress) const {
+    return arc_length.has_value() ? arc_length->parameter(progress)
+                                  : progress;
+  }
+};
+
+// compile-time building blocks of the interpolated trajectories. Rotation
+// policies write placement::rotation, position policies write
+// placement::position, both for a whole batch of parameters at once.
+namespace policy {
+
+// quaternion blends
+struct slerp {
+  static inline glm::quat blend(const glm::quat &a, const glm::quat &b,
+                                float t) {
+    return math::slerp(a, b, t);
+  }
+  static inline void batch(const glm::quat &a, const glm::quat &b,
+                           const float *t, math::quat_soa_ref out,
+                           std::size_t count) {
+    math::slerp_batch(a, b, t, out, count);
+  }
+  static inline void strip(const glm::quat &a, const glm::quat &b,
+                           const float *, math::quat_soa_ref out,
+                           std::size_t count) {
+    math::slerp_strip(a, b, out, count);
+  }
+};
+
+struct fast_slerp {
+  static inline glm::quat blend(const glm::quat &a, const glm::quat &b,
+                                float t) {
+    return math::fast_slerp(a, b, t);
+  }
+  static inline void batch(const glm::quat &a, const glm::quat &b,
+                           const float *t, math::quat_soa_ref out,
+                           std::size_t count) {
+    math::fast_slerp_batch(a, b, t, out, count);
+  }
+  static inline void strip(const glm::quat &a, const glm::quat &b,
+                           const float *t, math::quat_soa_ref out,
+                           std::size_t count) {
+    batch(a, b, t, out, count);
+  }
+};
+
+struct lerp {
+  static inline glm::quat blend(const glm::quat &a, const glm::quat &b,
+                                float t) {
+    return math::lerp(a, b, t);
+  }
+  static inline void batch(const glm::quat &a, const glm::quat &b,
+                           const float *t, math::quat_soa_ref out,
+                           std::size_t count) {
+    math::lerp_batch(a, b, t, out, count);
+  }
+  static inline void strip(const glm::quat &a, const glm::quat &b,
+                           const float *t, math::quat_soa_ref out,
+                           std::size_t count) {
+    batch(a, b, t, out, count);
+  }
+};
+
+// start to end quaternion rotation
+template <typename Blend> struct quat_rotation {
+  template <bool uniform>
+  static inline void evaluate(const simulation_settings &settings,
+                              const trajectory_cache &, const float *t,
+                              std::size_t count, placement *out) {
+    static thread_local math::quat_soa rotations;
+    rotations.resize(count);
+    if constexpr (uniform) {
+      Blend::strip(settings.quat_rotation_start, settings.quat_rotation_end, t,
+                   rotations.ref(), count);
+    } else {
+      Blend::batch(settings.quat_rotation_start, settings.quat_rotation_end, t,
+                   rotations.ref(), count);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      out[i].rotation = rotations.get(i);
+    }
+  }
+};
+
+// SQUAD through the keyframes
+template <typename Blend> struct squad_rotation {
+  template <bool uniform>
+  static inline void evaluate(const simulation_settings &,
+                              const trajectory_cache &cache, const float *t,
+                              std::size_t count, placement *out) {
+    for (std::size_t i = 0; i < count; ++i) {
+      out[i].rotation = cache.rotation.evaluate(t[i], Blend::blend);
+    }
+  }
+};
+
+// start to end euler angles, see euler_plan
+struct euler_rotation {
+  template <bool uniform>
+  static inline void evaluate(const simulation_settings &,
+                              const trajectory_cache &cache, const float *t,
+                              std::size_t count, placement *out) {
+    static thread_local std::vector<math::vec3> angles;
+    angles.resize(count);
+    cache.euler.evaluate_batch(t, count, angles.data());
+    for (std::size_t i = 0; i < count; ++i) {
+      // the euler angles are what is being visualized, so convert here
+      out[i].rotation = glm::quat(angles[i]);
+    }
+  }
+};
+
+// catmull-rom spline through the unwrapped keyframe euler angles
+struct euler_spline_rotation {
+  template <bool uniform>
+  static inline void evaluate(const simulation_settings &,
+                              const trajectory_cache &cache, const float *t,
+                              std::size_t count, placement *out) {
+    for (std::size_t i = 0; i < count; ++i) {
+      out[i].rotation = glm::quat(cache.euler_rotation.evaluate(t[i]));
+    }
+  }
+};
+
+// dual quaternion blends over the keys of the cache, Out is dual_quat or
+// affine_transform
+struct sclerp {
+  template <typename Out>
+  static inline void batch(const trajectory_cache &cache, const float *t,
+                           std::size_t count, Out *out) {
+    math::sclerp_batch(cache.screws.data(), cache.screws.size(), t, count,
+                       out);
+  }
+};
+
+struct dlb {
+  template <typename Out>
+  static inline void batch(const trajectory_cache &cache, const float *t,
+                           std::size_t count, Out *out) {
+    math::dlb_batch(cache.motions.data(), cache.motions.size(), t, count, out);
+  }
+};
+
+// rotation and position blended together as a rigid motion, writes both
+// members of the placement and is paired with rigid_position
+template <typename Blend> struct rigid_rotation {
+  template <bool uniform>
+  static inline void evaluate(const simulation_settings &,
+                              const trajectory_cache &cache, const float *t,
+                              std::size_t count, placement *out) {
+    static thread_local std::vector<math::dual_quat> motions;
+    motions.resize(count);
+    Blend::batch(cache, t, count, motions.data());
+    for (std::size_t i = 0; i < count; ++i) {
+      out[i].rotation = motions[i].real;
+      out[i].position = math::translation(motions[i]);
+    }
+  }
+};
+
+// position already written by rigid_rotation
+struct rigid_position {
+  static constexpr bool arc_length = false;
+
+  static inline void evaluate(const simulation_settings &,
+                              const trajectory_cache &, const float *,
+                              std::size_t, placement *) {}
+};
+
+struct linear_position {
+  static constexpr bool arc_length = false;
+
+  static inline void evaluate(const simulation_settings &settings,
+                              const trajectory_cache &, const float *t,
+                              std::size_t count, placement *out) {
+    for (std::size_t i = 0; i < count; ++i) {
+      out[i].position =
+          glm::mix(settings.position_start, settings.position_end, t[i]);
+    }
+  }
+};
+
+// catmull-rom spline through the keyframes, timed by the arc-length table
+struct spline_position {
+  static constexpr bool arc_length = true;
+
+  static inline void evaluate(const simulation_settings &,
+                              const trajectory_cache &cache, const float *t,
+                              std::size_t count, placement *out) {
+    for (std::size_t i = 0; i < count; ++i) {
+      out[i].position = cache.position.evaluate(t[i]);
+    }
+  }
+};
+
+} // namespace policy
+
+// evaluates placements for a batch of progress values in [0, 1], the
+// policies are fixed at compile time so the inner loops do not branch on
+// the settings
+template <typename RotationPolicy, typename PositionPolicy>
+struct trajectory_evaluator {
+  static void evaluate(const simulation_settings &settings,
+                       const trajectory_cache &cache, const float *progress,
+                       std::size_t count, placement *out) {
+    run<false>(settings, cache, progress, count, out);
+  }
+
+  // count uniformly spaced samples from start to end
+  static void evaluate_strip(const simulation_settings &settings,
+                             const trajectory_cache &cache, std::size_t count,
+                             placement *out) {
+    static thread_local std::vector<float> progress;
+    progress.resize(count);
+    const float step = count > 1 ? 1.f / static_cast<float>(count - 1) : 0.f;
+    for (std::size_t i = 0; i < count; ++i) {
+      progress[i] = static_cast<float>(i) * step;
+    }
+    run<!PositionPolicy::arc_length>(settings, cache, progress.data(), count,
+                                     out);
+  }
+
+private:
+  template <bool uniform>
+  static void run(const simulation_settings &settings,
+                  const trajectory_cache &cache, const float *progress,
+                  std::size_t count, placement *out) {
+    const float *t = progress;
+    if constexpr (PositionPolicy::arc_length) {
+      static thread_local std::vector<float> remapped;
+      remapped.resize(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        remapped[i] = cache.parameter(progress[i]);
+      }
+      t = remapped.data();
+    }
+    RotationPolicy::template evaluate<uniform>(settings, cache, t, count,
+                                               out);
+    PositionPolicy::evaluate(settings, cache, t, count, out);
+  }
+};
+
+// instance matrices of a rigid motion written straight from the blended
+// dual quaternions, without a placement in between. Unit scale, like the
+// placements the placement evaluators write.
+template <typename Blend> struct rigid_motion_evaluator {
+  static void evaluate_affine(const simulation_settings &,
+                              const trajectory_cache &cache,
+                              const float *progress, std::size_t count,
+                              math::affine_transform *out) {
+    Blend::batch(cache, progress, count, out);
+  }
+};
+
+// evaluators of both viewports, picked once when the simulation starts
+struct trajectory_evaluators {
+  using evaluate_t = void (*)(const simulation_settings &,
+                              const trajectory_cache &, const float *,
+                              std::size_t, placement *);
+  using evaluate_strip_t = void (*)(const simulation_settings &,
+                                    const trajectory_cache &, std::size_t,
+                                    placement *);
+
+  using evaluate_affine_t = void (*)(const simulation_settings &,
+                                     const trajectory_cache &, const float *,
+                                     std::size_t, math::affine_transform *);
+
+  // quaternion viewport
+  evaluate_t left{nullptr};
+  evaluate_strip_t left_strip{nullptr};
+  // euler angles viewport
+  evaluate_t right{nullptr};
+  evaluate_strip_t right_strip{nullptr};
+  // left animated instances of the dual quaternion methods, null for the
+  // others which go through the placements
+  evaluate_affine_t left_affine{nullptr};
+};
+
+trajectory_evaluators select_evaluators(const simulation_settings &settings);
+
+enum class motion_method : std::uint32_t { slerp = 0, lerp = 1, euler = 2 };
+
+// start to end motion of one instance evaluated on the gpu, std430 layout of
+// instance_motion in trajectory.comp
+struct instance_motion {
+  math::vec4 position_start; // w, start time in seconds
+  math::vec4 position_delta; // w, 1 / duration in seconds
+  math::vec4 rotation_start; // quaternion (x, y, z, w) or euler angles
+  math::vec4 rotation_end;   // quaternion, or the euler delta
+  motion_method method;
+  std::uint32_t padding[3];
+};
+static_assert(sizeof(instance_motion) == 80);
+
+// only plain start to end motions, keyframed and dual quaternion runs are
+// evaluated on the cpu. So is fast slerp, trajectory.comp only has the exact
+// one and the comparison would show the wrong curve.
+inline bool gpu_evaluable(const simulation_settings &settings) {
+  return settings.animation && settings.keyframes.empty() &&
+         !settings.dual_quaternion && !settings.fast_slerp;
+}
+
+// t0 is the start time relative to the start of the run
+inline instance_motion make_instance_motion(const simulation_settings &settings,
+                                            const trajectory_cache &cache,
+                                            bool euler, float t0) {
+  const auto &q0 = settings.quat_rotation_start;
+  const auto &q1 = settings.quat_rotation_end;
+  instance_motion m{};
+  m.position_start = math::vec4(settings.position_start, t0);
+  m.position_delta = math::vec4(settings.position_end - settings.position_start,
+                                1.f / settings.length);
+  if (euler) {
+    m.rotation_start = math::vec4(cache.euler.start, 0.f);
+    m.rotation_end = math::vec4(cache.euler.delta, 0.f);
+    m.method = motion_method::euler;
+  } else {
+    m.rotation_start = math::vec4(q0.x, q0.y, q0.z, q0.w);
+    m.rotation_end = math::vec4(q1.x, q1.y, q1.z, q1.w);
+    m.method = settings.slerp ? motion_method::slerp : motion_method::lerp;
+  }
+  return m;
+}
+
+} // namespace internal
+} // namespace pusn
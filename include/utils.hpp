@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -15,5 +17,16 @@ std::string read_text_file(std::filesystem::path shader_file);
 std::vector<std::string>
 read_text_lines_file(const std::filesystem::path input_file);
 
+// 64 bit fnv-1a, pass the previous result as hash to continue it
+inline std::uint64_t fnv1a(const void *data, std::size_t size,
+                           std::uint64_t hash = 14695981039346656037ull) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
 } // namespace utils
 } // namespace pusn
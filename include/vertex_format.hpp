@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <geometry.hpp>
+
+namespace pusn {
+
+// 20 byte vertex, float position, octahedral snorm16 normal and rgba8 color.
+// Matches the attribute layout set up by glfw_impl::fill_renderable for
+// packed meshes and decoded in model.vert.
+struct packed_vertex {
+  math::vec3 pos;
+  std::array<std::int16_t, 2> normal;
+  std::array<std::uint8_t, 4> color;
+};
+static_assert(sizeof(packed_vertex) == 20);
+
+// gpu ready copy of a mesh, indices are 16 bit whenever the vertex count
+// allows it and only one of the index vectors is filled
+struct packed_mesh {
+  std::vector<packed_vertex> vertices;
+  std::vector<std::uint16_t> indices16;
+  std::vector<std::uint32_t> indices32;
+
+  inline bool short_indices() const { return !indices16.empty(); }
+  inline std::size_t index_count() const {
+    return short_indices() ? indices16.size() : indices32.size();
+  }
+};
+
+// unit vector onto the octahedron unfolded into [-1, 1]^2, as snorm16
+inline std::array<std::int16_t, 2> octahedral_encode(const math::vec3 &n) {
+  const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+  float x = l1 > 0.f ? n.x / l1 : 0.f;
+  float y = l1 > 0.f ? n.y / l1 : 0.f;
+  if (n.z < 0.f) {
+    const float fx = (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f);
+    const float fy = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+    x = fx;
+    y = fy;
+  }
+  auto snorm = [](float v) {
+    return static_cast<std::int16_t>(
+        std::lround(std::fmax(-1.f, std::fmin(1.f, v)) * 32767.f));
+  };
+  return {snorm(x), snorm(y)};
+}
+
+inline packed_vertex pack_vertex(const pos_norm_col &v) {
+  auto unorm = [](float c) {
+    return static_cast<std::uint8_t>(
+        std::lround(std::fmax(0.f, std::fmin(1.f, c)) * 255.f));
+  };
+  return {v.pos,
+          octahedral_encode(v.normal),
+          {unorm(v.color.x), unorm(v.color.y), unorm(v.color.z), 255}};
+}
+
+packed_mesh pack_mesh(const api_agnostic_geometry &geometry);
+
+// reorders the triangles of an indexed triangle list for the post-transform
+// vertex cache (Forsyth's linear-speed optimizer, 32 entry lru model)
+std::vector<unsigned int>
+optimize_vertex_cache(const std::vector<unsigned int> &indices,
+                      std::size_t vertex_count);
+
+} // namespace pusn
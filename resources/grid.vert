@@ -5,8 +5,14 @@ layout(location = 1) in vec3 norm;
 layout(location = 2) in vec3 color;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
+// camera and light of the viewport, matches glfw_impl::frame_uniforms
+layout(std140, binding = 0) uniform frame {
+    mat4 view;
+    mat4 proj;
+    vec4 light_pos;
+    vec4 light_color;
+    vec4 cam_pos;
+};
 
 float gridSize = 10000.0f;
 float gridCellSize = 0.05f;
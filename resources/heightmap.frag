@@ -7,15 +7,20 @@ in vec3 frag_norm;
 in vec3 frag_pos;
 in vec2 frag_tex;
 
-uniform vec3 light_pos;
-uniform vec3 light_color;
-uniform vec3 cam_pos;
+// camera and light of the viewport, matches glfw_impl::frame_uniforms
+layout(std140, binding = 0) uniform frame {
+    mat4 view;
+    mat4 proj;
+    vec4 light_pos;
+    vec4 light_color;
+    vec4 cam_pos;
+};
 
 uniform sampler2D height_map;
-uniform sampler2D color;
+// of the stock, lit below
+uniform vec4 color;
 
 void main() {
-    vec4 color = vec4(texture(color, frag_tex).rgb, 1.0);
     vec3 ambient = vec3(0.1, 0.1, 0.1);
 
     vec3 normal = normalize( cross(dFdx(frag_pos), dFdy(frag_pos)) );
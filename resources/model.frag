@@ -5,9 +5,14 @@ in vec3 normal;
 in vec3 frag_pos;
 in vec3 color;
 
-uniform vec3 light_pos;
-uniform vec3 light_color;
-uniform vec3 cam_pos;
+// camera and light of the viewport, matches glfw_impl::frame_uniforms
+layout(std140, binding = 0) uniform frame {
+    mat4 view;
+    mat4 proj;
+    vec4 light_pos;
+    vec4 light_color;
+    vec4 cam_pos;
+};
 
 void main() {
     vec3 ambient = vec3(0.2, 0.2, 0.2);
@@ -1,20 +1,55 @@
 #version 460
 
 layout(location = 0) in vec3 pos;
-layout(location = 1) in vec3 norm;
-layout(location = 2) in vec3 col;
+// octahedral encoded normal and rgba8 color, see pusn::packed_vertex
+layout(location = 1) in vec2 norm_oct;
+layout(location = 2) in vec4 col;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
+// rows of the affine model matrix and of the normal matrix of an instance,
+// matches math::affine_transform
+struct affine_transform {
+    vec4 model[3];
+    vec4 normal[3];
+};
+
+layout(std430, binding = 0) readonly buffer instances {
+    affine_transform transforms[];
+};
+
+// instances grouped by level of detail, see interpolator_scene::render
+layout(std430, binding = 2) readonly buffer instance_ids_block {
+    uint instance_ids[];
+};
+
+// camera and light of the viewport, matches glfw_impl::frame_uniforms
+layout(std140, binding = 0) uniform frame {
+    mat4 view;
+    mat4 proj;
+    vec4 light_pos;
+    vec4 light_color;
+    vec4 cam_pos;
+};
 
 out vec3 frag_pos;
 out vec3 normal;
 out vec3 color;
 
+vec3 octahedral_decode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main() {
-    gl_Position = proj * view * model * vec4(pos, 1.0);
-    frag_pos = vec3(model * vec4(pos, 1.0));
-    normal = transpose(inverse(mat3(model))) * norm;
-    color = col;
+    const vec3 norm = octahedral_decode(norm_oct);
+    const affine_transform t =
+        transforms[instance_ids[gl_BaseInstance + gl_InstanceID]];
+    const vec4 p = vec4(pos, 1.0);
+    frag_pos = vec3(dot(t.model[0], p), dot(t.model[1], p), dot(t.model[2], p));
+    gl_Position = proj * view * vec4(frag_pos, 1.0);
+    normal = vec3(dot(t.normal[0].xyz, norm), dot(t.normal[1].xyz, norm),
+                  dot(t.normal[2].xyz, norm));
+    color = col.rgb;
 }
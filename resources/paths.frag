@@ -1,8 +1,10 @@
 #version 460
 
-in vec4 color;
+// executed and remaining parts of the path are drawn in different colors
+uniform vec4 color;
+
 out vec4 frag_color;
 
 void main() {
-    frag_color = vec4(0.0, 1.0, 0.0, 0.5);
+    frag_color = color;
 }
@@ -1,13 +1,20 @@
 #version 460
 
-layout(location = 0) in vec3 pos;
-layout(location = 1) in vec3 norm;
-layout(location = 2) in vec2 tex;
+// the toolpath's x, y and z arrays, see glfw_impl::fill_renderable
+layout(location = 0) in float x;
+layout(location = 1) in float y;
+layout(location = 2) in float z;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
+// camera and light of the viewport, matches glfw_impl::frame_uniforms
+layout(std140, binding = 0) uniform frame {
+    mat4 view;
+    mat4 proj;
+    vec4 light_pos;
+    vec4 light_color;
+    vec4 cam_pos;
+};
 
 void main() {
-    gl_Position = proj * view * model * vec4(pos, 1.0);
+    gl_Position = proj * view * model * vec4(x, y, z, 1.0);
 }
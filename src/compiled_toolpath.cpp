@@ -0,0 +1,266 @@
+#include <compiled_toolpath.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <logger.hpp>
+#include <utils.hpp>
+
+namespace pusn {
+
+namespace {
+
+// bump whenever the layout changes
+constexpr std::uint32_t compiled_version = 2;
+constexpr char compiled_magic[4] = {'P', 'T', 'P', 'H'};
+
+constexpr std::uint32_t flag_orientation = 1;
+
+// followed by x, y, z, line and distance, move_count entries each, and the
+// i, j and k tool axis arrays when flags has flag_orientation
+struct compiled_header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t tool_type;
+  float tool_diameter;
+  std::uint32_t flags;
+  std::uint32_t reserved;
+  std::uint64_t move_count;
+  // the program the file was compiled from
+  std::uint64_t source_size;
+  std::int64_t source_time;
+  std::uint64_t source_checksum;
+  float bounds_min[3];
+  float bounds_max[3];
+};
+static_assert(sizeof(compiled_header) % alignof(float) == 0);
+
+struct source_stamp {
+  std::uint64_t size;
+  std::int64_t time;
+};
+
+std::optional<source_stamp> stamp(const std::filesystem::path &program) {
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(program, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  const auto time = std::filesystem::last_write_time(program, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  return source_stamp{size, static_cast<std::int64_t>(
+                                time.time_since_epoch().count())};
+}
+
+std::filesystem::path compiled_path(const std::filesystem::path &program,
+                                    const std::filesystem::path &cache_dir) {
+  const auto source = std::filesystem::absolute(program).string();
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), "_%016llx.ptp",
+                static_cast<unsigned long long>(
+                    utils::fnv1a(source.data(), source.size())));
+  return cache_dir / "toolpaths" / (program.filename().string() + suffix);
+}
+
+std::uint64_t checksum(const std::filesystem::path &program) {
+  const auto file = utils::mapped_file::open(program);
+  return file.has_value() ? utils::fnv1a(file->data(), file->size()) : 0;
+}
+
+bool store(const std::filesystem::path &path, const toolpath &moves,
+           const source_stamp &source, std::uint64_t source_checksum) {
+  const std::size_t count = moves.size();
+  std::vector<float> distance(count, 0.f);
+  compiled_header header{{compiled_magic[0], compiled_magic[1],
+                          compiled_magic[2], compiled_magic[3]},
+                         compiled_version,
+                         static_cast<std::uint32_t>(moves.tool.type),
+                         moves.tool.diameter,
+                         moves.has_orientation() ? flag_orientation : 0,
+                         0,
+                         count,
+                         source.size,
+                         source.time,
+                         source_checksum,
+                         {0.f, 0.f, 0.f},
+                         {0.f, 0.f, 0.f}};
+  if (count > 0) {
+    math::vec3 lo{moves.x[0], moves.y[0], moves.z[0]};
+    math::vec3 hi = lo;
+    // accumulated in double, the float sum drifts over long programs
+    double travelled = 0.0;
+    for (std::size_t i = 1; i < count; ++i) {
+      const math::vec3 p{moves.x[i], moves.y[i], moves.z[i]};
+      const math::vec3 d{p.x - moves.x[i - 1], p.y - moves.y[i - 1],
+                         p.z - moves.z[i - 1]};
+      travelled += std::sqrt(static_cast<double>(d.x) * d.x +
+                             static_cast<double>(d.y) * d.y +
+                             static_cast<double>(d.z) * d.z);
+      distance[i] = static_cast<float>(travelled);
+      lo = glm::min(lo, p);
+      hi = glm::max(hi, p);
+    }
+    std::copy_n(&lo.x, 3, header.bounds_min);
+    std::copy_n(&hi.x, 3, header.bounds_max);
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  // written aside and renamed so a reader never maps a partial file
+  auto partial = path;
+  partial += ".part";
+  {
+    std::ofstream ofs(partial, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      LOGGER_WARN("[TOOLPATH] Could not write {0}", partial.string());
+      return false;
+    }
+    auto write = [&](const auto &values) {
+      ofs.write(reinterpret_cast<const char *>(values.data()),
+                sizeof(values[0]) * values.size());
+    };
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    write(moves.x);
+    write(moves.y);
+    write(moves.z);
+    write(moves.line);
+    write(distance);
+    if (moves.has_orientation()) {
+      write(moves.i);
+      write(moves.j);
+      write(moves.k);
+    }
+    if (!ofs) {
+      LOGGER_WARN("[TOOLPATH] Could not write {0}", partial.string());
+      return false;
+    }
+  }
+  std::filesystem::rename(partial, path, ec);
+  if (ec) {
+    LOGGER_WARN("[TOOLPATH] Could not write {0}", path.string());
+    return false;
+  }
+  return true;
+}
+
+// rewrites the program time in the header of a compiled file in place
+bool restamp(const std::filesystem::path &path, std::int64_t source_time) {
+  std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+  fs.seekp(offsetof(compiled_header, source_time));
+  fs.write(reinterpret_cast<const char *>(&source_time), sizeof(source_time));
+  return static_cast<bool>(fs);
+}
+
+} // namespace
+
+std::optional<compiled_toolpath>
+compiled_toolpath::load(const std::filesystem::path &program,
+                        const std::filesystem::path &cache_dir) {
+  const auto source = stamp(program);
+  if (!source.has_value()) {
+    LOGGER_ERROR("[TOOLPATH] Could not open {0}", program.string());
+    return std::nullopt;
+  }
+  const auto path = compiled_path(program, cache_dir);
+
+  auto map = [&]() -> std::optional<compiled_toolpath> {
+    if (!std::filesystem::exists(path)) {
+      return std::nullopt;
+    }
+    auto file = utils::mapped_file::open(path);
+    if (!file.has_value() || file->size() < sizeof(compiled_header)) {
+      return std::nullopt;
+    }
+    compiled_header header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    const std::size_t count = header.move_count;
+    const bool oriented = (header.flags & flag_orientation) != 0;
+    const std::size_t arrays = oriented ? 8 : 5;
+    if (!std::equal(header.magic, header.magic + 4, compiled_magic) ||
+        header.version != compiled_version ||
+        file->size() != sizeof(header) + arrays * sizeof(float) * count) {
+      return std::nullopt;
+    }
+    if (header.source_size != source->size) {
+      return std::nullopt;
+    }
+    // a touched but unchanged program keeps its compiled form, stamped with
+    // the new time so the next load skips the checksum
+    if (header.source_time != source->time) {
+      if (header.source_checksum != checksum(program)) {
+        return std::nullopt;
+      }
+      // the mapping shares the file for reading only
+      const auto size = file->size();
+      file.reset();
+      if (restamp(path, source->time)) {
+        LOGGER_INFO("[TOOLPATH] Restamped {0}", path.string());
+      } else {
+        LOGGER_WARN("[TOOLPATH] Could not restamp {0}", path.string());
+      }
+      file = utils::mapped_file::open(path);
+      if (!file.has_value() || file->size() != size) {
+        return std::nullopt;
+      }
+    }
+
+    compiled_toolpath out;
+    out.tool_ = {static_cast<tool_type>(header.tool_type),
+                 header.tool_diameter};
+    out.bounds_min_ = {header.bounds_min[0], header.bounds_min[1],
+                       header.bounds_min[2]};
+    out.bounds_max_ = {header.bounds_max[0], header.bounds_max[1],
+                       header.bounds_max[2]};
+    const auto *floats =
+        reinterpret_cast<const float *>(file->data() + sizeof(header));
+    out.x_ = {floats, count};
+    out.y_ = {floats + count, count};
+    out.z_ = {floats + 2 * count, count};
+    out.line_ = {reinterpret_cast<const std::uint32_t *>(floats + 3 * count),
+                 count};
+    out.distance_ = {floats + 4 * count, count};
+    if (oriented) {
+      out.i_ = {floats + 5 * count, count};
+      out.j_ = {floats + 6 * count, count};
+      out.k_ = {floats + 7 * count, count};
+    }
+    out.file_ = std::move(file.value());
+    return out;
+  };
+
+  if (auto compiled = map()) {
+    LOGGER_INFO("[TOOLPATH] Mapped {0} moves from {1}", compiled->size(),
+                path.string());
+    return compiled;
+  }
+
+  auto moves = toolpath_parser::load(program);
+  if (!moves.has_value() ||
+      !store(path, moves.value(), source.value(), checksum(program))) {
+    return std::nullopt;
+  }
+  LOGGER_INFO("[TOOLPATH] Compiled {0} into {1}", program.string(),
+              path.string());
+  return map();
+}
+
+std::size_t compiled_toolpath::segment_at(float d) const {
+  // a single move has no segment to end, it is its own position
+  if (distance_.size() < 2) {
+    return 0;
+  }
+  const auto it = std::upper_bound(distance_.begin(), distance_.end(), d);
+  if (it == distance_.end()) {
+    return distance_.size() - 1;
+  }
+  return std::max<std::size_t>(1, it - distance_.begin());
+}
+
+} // namespace pusn
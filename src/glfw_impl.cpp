@@ -1,8 +1,17 @@
 #include <glfw_impl.hpp>
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <span>
 
 #include <math.hpp>
 
@@ -69,6 +78,519 @@ void glfw_impl::fill_renderable(std::vector<pos_norm_col> &vertices,
   glVertexArrayAttribBinding(out.vao.value(), 0, 0);
   glVertexArrayAttribBinding(out.vao.value(), 1, 0);
   glVertexArrayAttribBinding(out.vao.value(), 2, 0);
+
+  out.index_type = GL_UNSIGNED_INT;
+}
+
+void glfw_impl::fill_renderable(const packed_mesh &mesh, renderable &out) {
+  if (!out.vbo.has_value()) {
+    GLuint tmp;
+    glCreateBuffers(1, &tmp);
+    out.vbo = tmp;
+  }
+  glNamedBufferData(out.vbo.value(),
+                    sizeof(packed_vertex) * mesh.vertices.size(),
+                    mesh.vertices.data(), GL_STATIC_DRAW);
+
+  if (!out.ebo.has_value()) {
+    GLuint tmp;
+    glCreateBuffers(1, &tmp);
+    out.ebo = tmp;
+  }
+  if (mesh.short_indices()) {
+    glNamedBufferData(out.ebo.value(),
+                      sizeof(std::uint16_t) * mesh.indices16.size(),
+                      mesh.indices16.data(), GL_STATIC_DRAW);
+    out.index_type = GL_UNSIGNED_SHORT;
+  } else {
+    glNamedBufferData(out.ebo.value(),
+                      sizeof(std::uint32_t) * mesh.indices32.size(),
+                      mesh.indices32.data(), GL_STATIC_DRAW);
+    out.index_type = GL_UNSIGNED_INT;
+  }
+
+  if (!out.vao.has_value()) {
+    GLuint tmp;
+    glCreateVertexArrays(1, &tmp);
+    out.vao = tmp;
+  }
+
+  glVertexArrayVertexBuffer(out.vao.value(), 0, out.vbo.value(), 0,
+                            sizeof(packed_vertex));
+  glVertexArrayElementBuffer(out.vao.value(), out.ebo.value());
+
+  glEnableVertexArrayAttrib(out.vao.value(), 0);
+  glEnableVertexArrayAttrib(out.vao.value(), 1);
+  glEnableVertexArrayAttrib(out.vao.value(), 2);
+
+  glVertexArrayAttribFormat(out.vao.value(), 0, 3, GL_FLOAT, GL_FALSE,
+                            offsetof(packed_vertex, pos));
+  glVertexArrayAttribFormat(out.vao.value(), 1, 2, GL_SHORT, GL_TRUE,
+                            offsetof(packed_vertex, normal));
+  glVertexArrayAttribFormat(out.vao.value(), 2, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                            offsetof(packed_vertex, color));
+
+  glVertexArrayAttribBinding(out.vao.value(), 0, 0);
+  glVertexArrayAttribBinding(out.vao.value(), 1, 0);
+  glVertexArrayAttribBinding(out.vao.value(), 2, 0);
+}
+
+void glfw_impl::fill_renderable(std::span<const float> x,
+                                std::span<const float> y,
+                                std::span<const float> z,
+                                const std::vector<std::uint32_t> &indices,
+                                renderable &out) {
+  if (!out.vbo.has_value()) {
+    GLuint tmp;
+    glCreateBuffers(1, &tmp);
+    out.vbo = tmp;
+  }
+  // the three arrays back to back, each read through its own binding
+  const std::size_t count = x.size();
+  const std::size_t array_size = sizeof(float) * count;
+  glNamedBufferData(out.vbo.value(), 3 * array_size, nullptr, GL_STATIC_DRAW);
+  glNamedBufferSubData(out.vbo.value(), 0, array_size, x.data());
+  glNamedBufferSubData(out.vbo.value(), array_size, array_size, y.data());
+  glNamedBufferSubData(out.vbo.value(), 2 * array_size, array_size, z.data());
+
+  if (!out.ebo.has_value()) {
+    GLuint tmp;
+    glCreateBuffers(1, &tmp);
+    out.ebo = tmp;
+  }
+  glNamedBufferData(out.ebo.value(), sizeof(std::uint32_t) * indices.size(),
+                    indices.data(), GL_STATIC_DRAW);
+  out.index_type = GL_UNSIGNED_INT;
+
+  if (!out.vao.has_value()) {
+    GLuint tmp;
+    glCreateVertexArrays(1, &tmp);
+    out.vao = tmp;
+  }
+  glVertexArrayElementBuffer(out.vao.value(), out.ebo.value());
+  for (GLuint i = 0; i < 3; ++i) {
+    glVertexArrayVertexBuffer(out.vao.value(), i, out.vbo.value(),
+                              i * array_size, sizeof(float));
+    glEnableVertexArrayAttrib(out.vao.value(), i);
+    glVertexArrayAttribFormat(out.vao.value(), i, 1, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(out.vao.value(), i, i);
+  }
+}
+
+glfw_impl::mesh_range glfw_impl::add_to_arena(const packed_mesh &mesh,
+                                              mesh_arena &arena) {
+  if (!mesh.short_indices()) {
+    LOGGER_ERROR("[ARENA] Mesh of {0} vertices needs 32 bit indices",
+                 mesh.vertices.size());
+    return {};
+  }
+  mesh_range range{static_cast<GLint>(arena.mesh.vertices.size()),
+                   static_cast<GLuint>(arena.mesh.indices16.size()),
+                   static_cast<GLuint>(mesh.indices16.size())};
+  arena.mesh.vertices.insert(arena.mesh.vertices.end(), mesh.vertices.begin(),
+                             mesh.vertices.end());
+  arena.mesh.indices16.insert(arena.mesh.indices16.end(),
+                              mesh.indices16.begin(), mesh.indices16.end());
+  return range;
+}
+
+void glfw_impl::upload_arena(mesh_arena &arena) {
+  fill_renderable(arena.mesh, arena.meta);
+}
+
+void glfw_impl::fill_buffer(const void *data, std::size_t size,
+                            buffer_t &out) {
+  if (!out.has_value()) {
+    GLuint tmp;
+    glCreateBuffers(1, &tmp);
+    out.index = tmp;
+  }
+  // grow geometrically so that strips of changing length do not reallocate
+  // every run, otherwise update in place
+  if (size > out.capacity) {
+    out.capacity = std::max(size, 2 * out.capacity);
+    glNamedBufferData(out.value(), out.capacity, nullptr, GL_DYNAMIC_DRAW);
+  }
+  // no data only reserves the storage, e.g. for compute output
+  if (size > 0 && data != nullptr) {
+    glNamedBufferSubData(out.value(), 0, size, data);
+  }
+}
+
+void glfw_impl::bind_uniform_buffer(buffer_t &buffer, GLuint binding) {
+  glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer.value());
+}
+
+void glfw_impl::bind_storage_buffer(buffer_t &buffer, GLuint binding) {
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer.value());
+}
+
+namespace {
+
+void wait_for_fence(GLsync &fence) {
+  if (fence == nullptr) {
+    return;
+  }
+  // flush on the first wait so the fence is guaranteed to signal
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  while (glClientWaitSync(fence, flags, 1'000'000) == GL_TIMEOUT_EXPIRED) {
+    flags = 0;
+  }
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+
+// the old buffer may still be bound for draws recorded this frame, deleting
+// it right away would reset those bindings, so it goes through the deferred
+// deletion queue
+void retire_stream_buffer(glfw_impl::stream_buffer &stream) {
+  for (auto &fence : stream.fences) {
+    if (fence != nullptr) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  if (stream.has_value()) {
+    glUnmapNamedBuffer(stream.value());
+    glfw_impl::defer_deletion(glfw_impl::resource_kind::buffer,
+                              stream.value());
+    stream.index.reset();
+  }
+  stream.mapped = nullptr;
+}
+
+void create_stream_buffer(glfw_impl::stream_buffer &stream,
+                          std::size_t region_size) {
+  GLint uniform_alignment = 256;
+  GLint storage_alignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+  stream.alignment = static_cast<std::size_t>(
+      std::max({uniform_alignment, storage_alignment, 16}));
+  stream.region_size = (region_size + stream.alignment - 1) /
+                       stream.alignment * stream.alignment;
+
+  const GLbitfield flags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  const auto size = static_cast<GLsizeiptr>(
+      stream.region_size * glfw_impl::stream_buffer::region_count);
+  GLuint tmp;
+  glCreateBuffers(1, &tmp);
+  glNamedBufferStorage(tmp, size, nullptr, flags);
+  stream.index = tmp;
+  stream.mapped =
+      static_cast<std::byte *>(glMapNamedBufferRange(tmp, 0, size, flags));
+}
+
+} // namespace
+
+void glfw_impl::begin_stream_frame(stream_buffer &stream) {
+  stream.region = (stream.region + 1) % stream_buffer::region_count;
+  stream.offset = 0;
+  wait_for_fence(stream.fences[stream.region]);
+}
+
+glfw_impl::stream_allocation
+glfw_impl::stream_allocate(stream_buffer &stream, std::size_t size) {
+  const auto aligned =
+      (size + stream.alignment - 1) / stream.alignment * stream.alignment;
+  if (!stream.has_value() || stream.offset + aligned > stream.region_size) {
+    const auto needed = std::max<std::size_t>(
+        {aligned, 2 * stream.region_size, 64 * 1024});
+    retire_stream_buffer(stream);
+    create_stream_buffer(stream, needed);
+    stream.offset = 0;
+  }
+  stream_allocation allocation{
+      stream.mapped + stream.region * stream.region_size + stream.offset,
+      stream.region * stream.region_size + stream.offset, size};
+  stream.offset += aligned;
+  return allocation;
+}
+
+void glfw_impl::bind_stream_range(stream_buffer &stream,
+                                  const stream_allocation &allocation,
+                                  GLenum target, GLuint binding) {
+  glBindBufferRange(target, binding, stream.value(),
+                    static_cast<GLintptr>(allocation.offset),
+                    static_cast<GLsizeiptr>(allocation.size));
+}
+
+void glfw_impl::end_stream_frame(stream_buffer &stream) {
+  if (!stream.has_value()) {
+    return;
+  }
+  stream.fences[stream.region] =
+      glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+namespace {
+
+// round to nearest even, overflow saturates to infinity
+std::uint16_t float_to_half(float value) {
+  const auto bits = std::bit_cast<std::uint32_t>(value);
+  const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+  const std::uint32_t magnitude = bits & 0x7fffffffu;
+  if (magnitude >= 0x47800000u) {
+    return sign | (magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u);
+  }
+  if (magnitude < 0x38800000u) {
+    // subnormal, in units of 2^-24
+    return sign | static_cast<std::uint16_t>(std::nearbyint(
+                      std::bit_cast<float>(magnitude) * 16777216.f));
+  }
+  std::uint32_t half = (magnitude - 0x38000000u) >> 13;
+  const std::uint32_t rest = magnitude & 0x1fffu;
+  if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) {
+    ++half;
+  }
+  return sign | static_cast<std::uint16_t>(half);
+}
+
+GLenum internal_format(glfw_impl::heightmap_format format) {
+  switch (format) {
+  case glfw_impl::heightmap_format::r16f:
+    return GL_R16F;
+  case glfw_impl::heightmap_format::r16:
+    return GL_R16;
+  default:
+    return GL_R32F;
+  }
+}
+
+GLenum texel_type(glfw_impl::heightmap_format format) {
+  switch (format) {
+  case glfw_impl::heightmap_format::r16f:
+    return GL_HALF_FLOAT;
+  case glfw_impl::heightmap_format::r16:
+    return GL_UNSIGNED_SHORT;
+  default:
+    return GL_FLOAT;
+  }
+}
+
+std::size_t texel_size(glfw_impl::heightmap_format format) {
+  return format == glfw_impl::heightmap_format::r32f ? 4 : 2;
+}
+
+// the cells of region as tightly packed texels of the texture's format
+void pack_heightmap(const glfw_impl::heightmap_texture &texture,
+                    const heightmap &map, const heightmap_region &region,
+                    std::byte *out) {
+  const int width = region.x1 - region.x0;
+  const float inv_scale =
+      texture.texture_scale != 0.f ? 1.f / texture.texture_scale : 0.f;
+  for (int y = region.y0; y < region.y1; ++y) {
+    const float *row = &map.at(region.x0, y);
+    switch (texture.texture_format) {
+    case glfw_impl::heightmap_format::r32f:
+      std::memcpy(out, row, sizeof(float) * width);
+      break;
+    case glfw_impl::heightmap_format::r16f: {
+      auto *texels = reinterpret_cast<std::uint16_t *>(out);
+      for (int x = 0; x < width; ++x) {
+        texels[x] = float_to_half(row[x]);
+      }
+      break;
+    }
+    case glfw_impl::heightmap_format::r16: {
+      auto *texels = reinterpret_cast<std::uint16_t *>(out);
+      for (int x = 0; x < width; ++x) {
+        const float unorm = std::clamp(
+            (row[x] - texture.texture_offset) * inv_scale, 0.f, 1.f);
+        texels[x] = static_cast<std::uint16_t>(unorm * 65535.f + 0.5f);
+      }
+      break;
+    }
+    }
+    out += texel_size(texture.texture_format) * width;
+  }
+}
+
+} // namespace
+
+float glfw_impl::quantization_error(heightmap_format format, float offset,
+                                    float scale) {
+  if (format == heightmap_format::r16) {
+    return 0.5f * std::abs(scale) / 65535.f;
+  }
+  // half the spacing of the representable values at the largest magnitude
+  const float largest = std::max(std::abs(offset), std::abs(offset + scale));
+  if (largest == 0.f) {
+    return 0.f;
+  }
+  const int mantissa_bits = format == heightmap_format::r16f ? 10 : 23;
+  return std::ldexp(0.5f, std::ilogb(largest) - mantissa_bits);
+}
+
+void glfw_impl::upload_heightmap(heightmap_texture &out, heightmap &map) {
+  if (map.width <= 0 || map.height <= 0) {
+    return;
+  }
+  if (!out.has_value() || out.width != map.width ||
+      out.height != map.height || out.texture_format != out.format) {
+    out.texture =
+        create_texture_2d(internal_format(out.format), map.width, map.height);
+    glTextureParameteri(out.value(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(out.value(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(out.value(), GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(out.value(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    out.width = map.width;
+    out.height = map.height;
+    out.texture_format = out.format;
+    map.mark_dirty();
+  }
+  // texels packed for another range are all repacked
+  if (out.texture_format == heightmap_format::r16 &&
+      (out.texture_offset != out.offset || out.texture_scale != out.scale)) {
+    out.texture_offset = out.offset;
+    out.texture_scale = out.scale;
+    map.mark_dirty();
+  }
+
+  // runs of dirty tiles along every row of tiles, one copy each
+  std::vector<heightmap_region> regions;
+  const int tiles_x = map.tiles_x();
+  for (int ty = 0; ty < map.tiles_y(); ++ty) {
+    auto *flags =
+        map.dirty_tiles.data() + static_cast<std::size_t>(ty) * tiles_x;
+    for (int tx = 0; tx < tiles_x;) {
+      if (flags[tx] == 0) {
+        ++tx;
+        continue;
+      }
+      auto region = map.tile_region(tx, ty);
+      for (; tx < tiles_x && flags[tx] != 0; ++tx) {
+        flags[tx] = 0;
+        region.x1 = map.tile_region(tx, ty).x1;
+      }
+      regions.push_back(region);
+    }
+  }
+  if (regions.empty()) {
+    return;
+  }
+  // a few floats per tile, cheaper to resend than to track
+  if (map.tile_variance.size() == map.dirty_tiles.size()) {
+    fill_buffer(map.tile_variance.data(),
+                sizeof(float) * map.tile_variance.size(), out.patch_variance);
+  }
+
+  const GLenum type = texel_type(out.texture_format);
+  const std::size_t texel = texel_size(out.texture_format);
+  std::size_t staged = 0;
+  std::vector<std::byte> client;
+  begin_stream_frame(out.staging);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (const auto &region : regions) {
+    const int width = region.x1 - region.x0;
+    const int height = region.y1 - region.y0;
+    const std::size_t size = texel * width * height;
+    if (staged + size <= out.staging_budget) {
+      const auto allocation = stream_allocate(out.staging, size);
+      pack_heightmap(out, map, region, allocation.data);
+      staged += size;
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, out.staging.value());
+      glTextureSubImage2D(out.value(), 0, region.x0, region.y0, width, height,
+                          GL_RED, type,
+                          reinterpret_cast<const void *>(allocation.offset));
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else if (out.texture_format == heightmap_format::r32f) {
+      // the rows are already texels, read them in place
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, map.width);
+      glTextureSubImage2D(out.value(), 0, region.x0, region.y0, width, height,
+                          GL_RED, type, &map.at(region.x0, region.y0));
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    } else {
+      client.resize(size);
+      pack_heightmap(out, map, region, client.data());
+      glTextureSubImage2D(out.value(), 0, region.x0, region.y0, width, height,
+                          GL_RED, type, client.data());
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  end_stream_frame(out.staging);
+}
+
+void glfw_impl::fill_heightmap_patches(const heightmap &map,
+                                       renderable &out) {
+  // corners of the tiles, the patch plane is z = 0 with the heights added
+  // along +z by heightmap.tese
+  const int columns = map.tiles_x() + 1;
+  const int rows = map.tiles_y() + 1;
+  std::vector<pos_norm_col> vertices;
+  vertices.reserve(static_cast<std::size_t>(columns) * rows);
+  for (int ty = 0; ty < rows; ++ty) {
+    const int y = std::min(ty * heightmap::tile_size, map.height);
+    for (int tx = 0; tx < columns; ++tx) {
+      const int x = std::min(tx * heightmap::tile_size, map.width);
+      vertices.push_back(
+          {{map.origin.x + x * map.cell_size.x,
+            map.origin.y + y * map.cell_size.y, 0.f},
+           {0.f, 0.f, 1.f},
+           {static_cast<float>(x) / map.width,
+            static_cast<float>(y) / map.height, 0.f}});
+    }
+  }
+
+  // one patch per tile in tile order, so gl_PrimitiveID indexes
+  // tile_variance. u runs along y and v along x, which makes
+  // cross(v, u) the +z heightmap.tese displaces along.
+  std::vector<unsigned int> indices;
+  indices.reserve(4 * static_cast<std::size_t>(columns - 1) * (rows - 1));
+  for (int ty = 0; ty + 1 < rows; ++ty) {
+    for (int tx = 0; tx + 1 < columns; ++tx) {
+      const auto corner = [&](int dx, int dy) {
+        return static_cast<unsigned int>((ty + dy) * columns + tx + dx);
+      };
+      indices.push_back(corner(0, 0));
+      indices.push_back(corner(0, 1));
+      indices.push_back(corner(1, 0));
+      indices.push_back(corner(1, 1));
+    }
+  }
+  fill_renderable(vertices, indices, out);
+}
+
+void glfw_impl::add_heightmap_program(heightmap_renderable &out) {
+  add_program_to_renderable("resources/heightmap", out.patches);
+  const auto &patches = out.patches;
+  out.model = patches.uniform_location("model");
+  out.viewport = patches.uniform_location("viewport");
+  out.patch_grid = patches.uniform_location("patch_grid");
+  out.height_map = patches.uniform_location("height_map");
+  out.height_offset = patches.uniform_location("height_offset");
+  out.height_scale = patches.uniform_location("height_scale");
+  out.edge_pixels = patches.uniform_location("edge_pixels");
+  out.max_error_pixels = patches.uniform_location("max_error_pixels");
+  out.color = patches.uniform_location("color");
+}
+
+void glfw_impl::render_heightmap(const heightmap_renderable &meta,
+                                 heightmap_texture &texture,
+                                 const heightmap &map,
+                                 const heightmap_draw &draw) {
+  const int tiles_x = map.tiles_x();
+  const int tiles_y = map.tiles_y();
+  if (!texture.has_value() || tiles_x == 0 || tiles_y == 0) {
+    return;
+  }
+  use_program(meta.patches.program.value());
+  set_uniform(meta.model, draw.model);
+  set_uniform(meta.viewport, draw.viewport);
+  // gl_PrimitiveID is split into the tile by it, never zero here
+  set_uniform(meta.patch_grid, math::ivec2(tiles_x, tiles_y));
+  set_uniform(meta.height_map, GLint{0});
+  set_uniform(meta.height_offset, texture.sample_offset());
+  set_uniform(meta.height_scale, texture.sample_scale());
+  set_uniform(meta.edge_pixels, draw.edge_pixels);
+  set_uniform(meta.max_error_pixels, draw.max_error_pixels);
+  set_uniform(meta.color, draw.color);
+  glBindTextureUnit(0, texture.value());
+  bind_storage_buffer(texture.patch_variance,
+                      heightmap_texture::patch_variance_binding);
+  render(meta.patches, 0, 4 * static_cast<std::size_t>(tiles_x) * tiles_y,
+         render_mode::patches);
 }
 
 void glfw_impl::framebuffer_size_callback(GLFWwindow *window, int width,
@@ -303,10 +825,70 @@ void glfw_impl::after_frame(window_t &w) {
   last_frame_info::last_frame_time =
       static_cast<double>(end_time - last_frame_info::begin_time) * 1000.f /
       freq;
+  collect_deferred_deletions();
   swap_buffers(w);
   poll_events(w);
 }
 
+namespace {
+
+struct deferred_batch {
+  GLsync fence{nullptr};
+  std::vector<std::pair<glfw_impl::resource_kind, GLuint>> names;
+};
+
+// names released this frame, and older batches waiting for their fence
+std::vector<std::pair<glfw_impl::resource_kind, GLuint>> released;
+std::deque<deferred_batch> pending_deletions;
+
+void delete_resource(glfw_impl::resource_kind kind, GLuint name) {
+  using glfw_impl::resource_kind;
+  switch (kind) {
+  case resource_kind::texture:
+    glDeleteTextures(1, &name);
+    break;
+  case resource_kind::buffer:
+    glDeleteBuffers(1, &name);
+    break;
+  case resource_kind::framebuffer:
+    glDeleteFramebuffers(1, &name);
+    break;
+  case resource_kind::vertex_array:
+    glDeleteVertexArrays(1, &name);
+    break;
+  case resource_kind::program:
+    glDeleteProgram(name);
+    break;
+  }
+}
+
+} // namespace
+
+void glfw_impl::defer_deletion(resource_kind kind, GLuint name) {
+  released.emplace_back(kind, name);
+}
+
+void glfw_impl::collect_deferred_deletions() {
+  if (!released.empty()) {
+    pending_deletions.push_back(
+        {glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(released)});
+    released.clear();
+  }
+  // batches are fenced in order, stop at the first one still in flight
+  while (!pending_deletions.empty()) {
+    auto &batch = pending_deletions.front();
+    const auto status = glClientWaitSync(batch.fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      break;
+    }
+    glDeleteSync(batch.fence);
+    for (const auto &[kind, name] : batch.names) {
+      delete_resource(kind, name);
+    }
+    pending_deletions.pop_front();
+  }
+}
+
 GLuint compile_shader_from_source(const std::string &source, GLuint type) {
   GLuint shader = glCreateShader(type);
   const char *src = source.c_str();
@@ -325,45 +907,112 @@ GLuint compile_shader_from_source(const std::string &source, GLuint type) {
   return shader;
 }
 
-void glfw_impl::add_program_to_renderable(const std::string &program_name,
-                                          renderable &out) {
-  namespace fs = std::filesystem;
-  // optional stages
-  std::optional<GLuint> tesc_shader;
-  std::optional<GLuint> tese_shader;
+// reflect the active uniforms once, array uniforms are reported as name[0]
+void reflect_uniforms(GLuint program, glfw_impl::renderable &out) {
+  out.uniform_locations.clear();
+  GLint uniform_count = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_count);
+  for (GLint i = 0; i < uniform_count; ++i) {
+    GLchar name[256];
+    GLsizei name_length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(program, i, sizeof(name), &name_length, &size, &type,
+                       name);
+    const GLint location = glGetUniformLocation(program, name);
+    // members of uniform blocks have no location
+    if (location >= 0) {
+      out.uniform_locations.emplace(std::string(name, name_length), location);
+    }
+  }
+}
 
-  std::string vert_source =
-      utils::read_text_file((program_name + ".vert").c_str());
-  std::string frag_source =
-      utils::read_text_file((program_name + ".frag").c_str());
+namespace {
 
-  if (fs::exists(program_name + ".tesc")) {
-    std::string tesc_source =
-        utils::read_text_file((program_name + ".tesc").c_str());
-    tesc_shader =
-        compile_shader_from_source(tesc_source, GL_TESS_CONTROL_SHADER);
-  }
+using stage_sources = std::vector<std::pair<GLenum, std::string>>;
 
-  if (fs::exists(program_name + ".tese")) {
-    std::string tese_source =
-        utils::read_text_file((program_name + ".tese").c_str());
-    tese_shader =
-        compile_shader_from_source(tese_source, GL_TESS_EVALUATION_SHADER);
+const std::filesystem::path program_cache_dir{"cache/programs"};
+
+// hash of the sources and of the driver, a driver update invalidates the
+// binaries
+std::filesystem::path program_cache_path(const std::string &program_name,
+                                         const stage_sources &sources) {
+  auto hash = utils::fnv1a(nullptr, 0);
+  for (const auto &[stage, source] : sources) {
+    hash = utils::fnv1a(&stage, sizeof(stage), hash);
+    hash = utils::fnv1a(source.data(), source.size(), hash);
+  }
+  for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    const auto *value = reinterpret_cast<const char *>(glGetString(name));
+    if (value != nullptr) {
+      hash = utils::fnv1a(value, std::strlen(value), hash);
+    }
   }
+  char file_name[32];
+  std::snprintf(file_name, sizeof(file_name), "_%016llx.bin",
+                static_cast<unsigned long long>(hash));
+  return program_cache_dir /
+         (std::filesystem::path(program_name).filename().string() +
+          file_name);
+}
 
-  GLuint vertex_shader =
-      compile_shader_from_source(vert_source, GL_VERTEX_SHADER);
-  GLuint frag_shader =
-      compile_shader_from_source(frag_source, GL_FRAGMENT_SHADER);
+std::optional<GLuint> load_program_binary(const std::filesystem::path &path) {
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs) {
+    return std::nullopt;
+  }
+  GLenum format = 0;
+  ifs.read(reinterpret_cast<char *>(&format), sizeof(format));
+  std::vector<char> binary{std::istreambuf_iterator<char>{ifs}, {}};
+  if (binary.empty()) {
+    return std::nullopt;
+  }
 
   GLuint program = glCreateProgram();
+  glProgramBinary(program, format, binary.data(),
+                  static_cast<GLsizei>(binary.size()));
+  GLint plinked;
+  glGetProgramiv(program, GL_LINK_STATUS, &plinked);
+  if (plinked != GL_TRUE) {
+    // stale, e.g. written by another driver build
+    glDeleteProgram(program);
+    return std::nullopt;
+  }
+  return program;
+}
 
-  glAttachShader(program, vertex_shader);
-  glAttachShader(program, frag_shader);
+void store_program_binary(GLuint program, const std::filesystem::path &path) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+  if (!ofs) {
+    LOGGER_WARN("[PROG CACHE] Could not write {0}", path.string());
+    return;
+  }
+  ofs.write(reinterpret_cast<const char *>(&format), sizeof(format));
+  ofs.write(binary.data(), binary.size());
+}
 
-  if (tesc_shader.has_value() && tese_shader.has_value()) {
-    glAttachShader(program, tesc_shader.value());
-    glAttachShader(program, tese_shader.value());
+GLuint link_program(const stage_sources &sources) {
+  std::vector<GLuint> shaders;
+  shaders.reserve(sources.size());
+  for (const auto &[stage, source] : sources) {
+    shaders.push_back(compile_shader_from_source(source, stage));
+  }
+
+  GLuint program = glCreateProgram();
+  glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  for (const auto shader : shaders) {
+    glAttachShader(program, shader);
   }
 
   glLinkProgram(program);
@@ -377,14 +1026,77 @@ void glfw_impl::add_program_to_renderable(const std::string &program_name,
     LOGGER_ERROR("[PROG LINK] {0}", message);
   }
 
-  glDeleteShader(vertex_shader);
-  glDeleteShader(frag_shader);
+  for (const auto shader : shaders) {
+    glDeleteShader(shader);
+  }
+  return program;
+}
 
-  if (tesc_shader.has_value() && tese_shader.has_value()) {
-    glDeleteShader(tesc_shader.value());
-    glDeleteShader(tese_shader.value());
+// the linked binary from the cache when it matches the sources, otherwise
+// compiles and links them and refreshes the cache
+GLuint cached_program(const std::string &program_name,
+                      const stage_sources &sources) {
+  const auto path = program_cache_path(program_name, sources);
+  if (auto program = load_program_binary(path)) {
+    LOGGER_INFO("[PROG CACHE] Loaded {0}", path.string());
+    return program.value();
+  }
+
+  GLuint program = link_program(sources);
+  GLint plinked;
+  glGetProgramiv(program, GL_LINK_STATUS, &plinked);
+  if (plinked == GL_TRUE) {
+    store_program_binary(program, path);
+  }
+  return program;
+}
+
+} // namespace
+
+void glfw_impl::add_program_to_renderable(const std::string &program_name,
+                                          renderable &out) {
+  namespace fs = std::filesystem;
+  stage_sources sources;
+  sources.emplace_back(GL_VERTEX_SHADER, utils::read_text_file(
+                                             (program_name + ".vert").c_str()));
+  sources.emplace_back(GL_FRAGMENT_SHADER,
+                       utils::read_text_file((program_name + ".frag").c_str()));
+
+  // optional stages, used when both are present
+  if (fs::exists(program_name + ".tesc") &&
+      fs::exists(program_name + ".tese")) {
+    sources.emplace_back(
+        GL_TESS_CONTROL_SHADER,
+        utils::read_text_file((program_name + ".tesc").c_str()));
+    sources.emplace_back(
+        GL_TESS_EVALUATION_SHADER,
+        utils::read_text_file((program_name + ".tese").c_str()));
   }
+
+  GLuint program = cached_program(program_name, sources);
   out.program = program;
+  reflect_uniforms(program, out);
+}
+
+void glfw_impl::add_compute_program_to_renderable(
+    const std::string &program_name, renderable &out) {
+  const stage_sources sources{
+      {GL_COMPUTE_SHADER,
+       utils::read_text_file((program_name + ".comp").c_str())}};
+
+  GLuint program = cached_program(program_name, sources);
+  out.program = program;
+  reflect_uniforms(program, out);
+}
+
+void glfw_impl::dispatch_compute(std::size_t invocations,
+                                 std::size_t local_size) {
+  const auto groups = (invocations + local_size - 1) / local_size;
+  if (groups == 0) {
+    return;
+  }
+  glDispatchCompute(static_cast<GLuint>(groups), 1, 1);
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
 void glfw_impl::use_program(GLuint program) { glUseProgram(program); }
@@ -394,14 +1106,70 @@ void glfw_impl::render(const renderable &meta,
   glBindVertexArray(meta.vao.value());
   glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
   if (mode == render_mode::triangles) {
-    glDrawElements(GL_TRIANGLES, geom.indices.size(), GL_UNSIGNED_INT, NULL);
+    glDrawElements(GL_TRIANGLES, geom.indices.size(), meta.index_type, NULL);
   } else if (mode == render_mode::patches) {
-    glDrawElements(GL_PATCHES, geom.indices.size(), GL_UNSIGNED_INT, NULL);
+    // quads, see heightmap.tesc
+    glPatchParameteri(GL_PATCH_VERTICES, 4);
+    glDrawElements(GL_PATCHES, geom.indices.size(), meta.index_type, NULL);
   } else if (mode == render_mode::line_strip) {
     glLineWidth(4.f);
-    glDrawElements(GL_LINE_STRIP, geom.indices.size(), GL_UNSIGNED_INT, NULL);
+    glDrawElements(GL_LINE_STRIP, geom.indices.size(), meta.index_type, NULL);
     glLineWidth(1.f);
   }
 }
 
+void glfw_impl::render(const renderable &meta, std::size_t first_index,
+                       std::size_t index_count, render_mode mode) {
+  render_instanced(meta, first_index, index_count, 1, mode);
+}
+
+void glfw_impl::render_indirect(const renderable &meta,
+                                GLuint indirect_buffer, std::size_t offset,
+                                std::size_t command_count, render_mode mode) {
+  if (command_count == 0) {
+    return;
+  }
+  glBindVertexArray(meta.vao.value());
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  const GLenum primitive =
+      mode == render_mode::patches      ? GL_PATCHES
+      : mode == render_mode::line_strip ? GL_LINE_STRIP
+                                        : GL_TRIANGLES;
+  glMultiDrawElementsIndirect(primitive, meta.index_type,
+                              reinterpret_cast<const void *>(offset),
+                              static_cast<GLsizei>(command_count), 0);
+}
+
+void glfw_impl::render_instanced(const renderable &meta,
+                                 const api_agnostic_geometry &geom,
+                                 std::size_t instance_count,
+                                 render_mode mode) {
+  render_instanced(meta, 0, geom.indices.size(), instance_count, mode);
+}
+
+void glfw_impl::render_instanced(const renderable &meta,
+                                 std::size_t first_index,
+                                 std::size_t index_count,
+                                 std::size_t instance_count,
+                                 render_mode mode) {
+  if (instance_count == 0 || index_count == 0) {
+    return;
+  }
+  glBindVertexArray(meta.vao.value());
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  if (mode == render_mode::patches) {
+    glPatchParameteri(GL_PATCH_VERTICES, 4);
+  }
+  const GLenum primitive =
+      mode == render_mode::patches      ? GL_PATCHES
+      : mode == render_mode::line_strip ? GL_LINE_STRIP
+                                        : GL_TRIANGLES;
+  glDrawElementsInstanced(
+      primitive, static_cast<GLsizei>(index_count), meta.index_type,
+      reinterpret_cast<const void *>(first_index *
+                                     index_size(meta.index_type)),
+      static_cast<GLsizei>(instance_count));
+}
+
 } // namespace pusn
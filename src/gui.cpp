@@ -11,6 +11,7 @@
 
 #include <ImGuiFileDialog.h>
 
+#include <algorithm>
 #include <chrono>
 
 namespace pusn {
@@ -18,9 +19,12 @@ namespace gui {
 
 struct gui_info {
   static std::string file_error_message;
+  // the popup is opened from render_popups so it shares its id stack
+  static bool show_file_error;
 };
 
 std::string gui_info::file_error_message{""};
+bool gui_info::show_file_error{false};
 
 // utility structure for realtime plot
 struct ScrollingBuffer {
@@ -254,6 +258,54 @@ void render_light_gui(internal::light &light) {
   ImGui::End();
 }
 
+void render_keyframes_gui(internal::simulation_settings &settings) {
+  if (!ImGui::CollapsingHeader("Keyframes")) {
+    return;
+  }
+
+  std::optional<std::size_t> to_remove;
+  for (std::size_t i = 0; i < settings.keyframes.size(); ++i) {
+    auto &key = settings.keyframes[i];
+    ImGui::PushID(static_cast<int>(i));
+    ImGui::Text("Keyframe %zu", i + 1);
+    ImGui::DragFloat3("Position", glm::value_ptr(key.position), -1000, 1000);
+    if (ImGui::DragFloat4("Quaternion", glm::value_ptr(key.quat_rotation),
+                          -100.f, 100.f)) {
+      key.euler_rotation = glm::eulerAngles(key.quat_rotation);
+    }
+    if (ImGui::DragFloat3("Euler Angles", glm::value_ptr(key.euler_rotation),
+                          -2 * glm::pi<float>(), 2 * glm::pi<float>())) {
+      key.quat_rotation = glm::quat(key.euler_rotation);
+    }
+    if (ImGui::Button("Remove")) {
+      to_remove = i;
+    }
+    ImGui::PopID();
+  }
+
+  if (to_remove.has_value()) {
+    settings.keyframes.erase(settings.keyframes.begin() + to_remove.value());
+  }
+
+  ImGui::Checkbox("Constant Speed", &settings.constant_speed);
+
+  if (ImGui::Button("Add Keyframe")) {
+    // halfway between the last key and the end pose
+    internal::keyframe key;
+    const internal::keyframe *last =
+        settings.keyframes.empty() ? nullptr : &settings.keyframes.back();
+    const auto position = last ? last->position : settings.position_start;
+    const auto rotation = last ? last->quat_rotation
+                               : settings.quat_rotation_start;
+    key.position = 0.5f * (position + settings.position_end);
+    key.quat_rotation =
+        math::slerp(glm::normalize(rotation),
+                    glm::normalize(settings.quat_rotation_end), 0.5f);
+    key.euler_rotation = glm::eulerAngles(key.quat_rotation);
+    settings.keyframes.push_back(key);
+  }
+}
+
 void render_simulation_gui(internal::model &model) {
   ImGui::Begin("Simulation Settings");
   ImGui::DragFloat("Length", &model.next_settings.length, 1.f, 20.f);
@@ -294,11 +346,28 @@ void render_simulation_gui(internal::model &model) {
         glm::quat(model.next_settings.euler_rotation_end);
   }
 
+  render_keyframes_gui(model.next_settings);
+
   ImGui::Checkbox("SLERP", &model.next_settings.slerp);
+  ImGui::SameLine();
+  ImGui::Checkbox("Fast SLERP", &model.next_settings.fast_slerp);
+
+  if (model.next_settings.slerp && model.next_settings.fast_slerp) {
+    const float max_error = math::fast_slerp_max_error(
+        glm::normalize(model.next_settings.quat_rotation_start),
+        glm::normalize(model.next_settings.quat_rotation_end));
+    ImGui::Text("Max error vs SLERP: %.2e rad", max_error);
+  }
+  ImGui::Checkbox("Dual Quaternion", &model.next_settings.dual_quaternion);
+  if (model.next_settings.dual_quaternion) {
+    ImGui::SameLine();
+    ImGui::Checkbox("ScLERP", &model.next_settings.screw);
+  }
   ImGui::Checkbox("Animate", &model.next_settings.animation);
 
   if (!model.next_settings.animation) {
-    ImGui::DragInt("Frames", &model.next_settings.frames);
+    ImGui::DragInt("Frames", &model.next_settings.frames, 1.f, 1, 10000, "%d",
+                   ImGuiSliderFlags_AlwaysClamp);
   }
 
   if (ImGui::Button("Run")) {
@@ -314,77 +383,30 @@ void render_simulation_gui(internal::model &model) {
       if (omega < 0) {
         model.next_settings.quat_rotation_end *= -1;
       }
+      for (auto &key : model.next_settings.keyframes) {
+        key.quat_rotation = glm::normalize(key.quat_rotation);
+      }
 
       model.current_settings = model.next_settings;
-
-      model.left_placements.clear();
-      model.right_placements.clear();
+      model.cache.build(model.current_settings.value());
+      model.evaluators =
+          internal::select_evaluators(model.current_settings.value());
+      model.start_gpu_animation();
 
       if (!model.current_settings.value().animation) {
-        for (int i = 0; i < model.current_settings.value().frames; ++i) {
-          float progress = static_cast<float>(i) /
-                           (model.current_settings.value().frames - 1);
-          // left (quaternion)
-          scene_object_info curr;
-          curr.position =
-              (1 - progress) * model.current_settings.value().position_start +
-              progress * model.current_settings.value().position_end;
-
-          if (model.current_settings.value().slerp) {
-            curr.rotation = glm::degrees(glm::eulerAngles(glm::normalize(
-                math::slerp(model.current_settings.value().quat_rotation_start,
-                            model.current_settings.value().quat_rotation_end,
-                            progress))));
-          } else {
-            curr.rotation = glm::degrees(glm::eulerAngles(glm::normalize(
-                math::lerp(model.current_settings.value().quat_rotation_start,
-                           model.current_settings.value().quat_rotation_end,
-                           progress))));
-          }
-
-          model.left_placements.push_back(curr);
-
-          // right (euler angles)
-          // 1. check if reversed will be needed
-          auto eu_st = model.current_settings.value().euler_rotation_start;
-          auto eu_en = model.current_settings.value().euler_rotation_end;
-
-          const float pi = glm::pi<float>();
-          const float tau = 2 * glm::pi<float>();
-
-          eu_st = {std::fmod(eu_st.x, tau), std::fmod(eu_st.y, tau),
-                   std::fmod(eu_st.z, tau)};
-
-          eu_en = {std::fmod(eu_en.x, tau), std::fmod(eu_en.y, tau),
-                   std::fmod(eu_en.z, tau)};
-
-          const auto dist = eu_en - eu_st;
-
-          if (std::abs(dist.x) > pi) {
-            if (eu_en.x > eu_st.x) {
-              eu_st.x += tau;
-            } else {
-              eu_en.x += tau;
-            }
-          }
-          if (std::abs(dist.y) > pi) {
-            if (eu_en.y > eu_st.y) {
-              eu_st.y += tau;
-            } else {
-              eu_en.y += tau;
-            }
-          }
-          if (std::abs(dist.z) > pi) {
-            if (eu_en.z > eu_st.z) {
-              eu_st.z += tau;
-            } else {
-              eu_en.z += tau;
-            }
-          }
-
-          curr.rotation = glm::degrees(glm::mix(eu_st, eu_en, progress));
-          model.right_placements.push_back(curr);
-        }
+        const auto frames = static_cast<std::size_t>(
+            std::max(model.current_settings.value().frames, 1));
+        model.left_placements.resize(frames);
+        model.right_placements.resize(frames);
+        // left (quaternion)
+        model.evaluators.left_strip(model.current_settings.value(),
+                                    model.cache, frames,
+                                    model.left_placements.data());
+        // right (euler angles)
+        model.evaluators.right_strip(model.current_settings.value(),
+                                     model.cache, frames,
+                                     model.right_placements.data());
+        model.mark_placements_dirty();
         model.current_settings.reset();
       }
     }
@@ -413,10 +435,69 @@ void render_converter() {
   ImGui::End();
 }
 
+void render_toolpath_gui(internal::toolpath_view &toolpath) {
+  static std::string program{"resources/programs/paths2/4.k08"};
+
+  ImGui::Begin("Toolpath");
+  ImGui::InputText("Program", &program);
+  if (ImGui::Button("Load")) {
+    if (!toolpath.load(program)) {
+      gui_info::file_error_message = program;
+      gui_info::show_file_error = true;
+    }
+  }
+
+  if (toolpath.path.has_value()) {
+    const auto &path = toolpath.path.value();
+    ImGui::Text("%zu moves, %.1f mm, %s %.0f mm", path.size(), path.length(),
+                path.tool().type == tool_type::ball ? "ball" : "flat",
+                path.tool().diameter);
+    ImGui::Checkbox("Visible", &toolpath.visible);
+    ImGui::SliderFloat("Progress", &toolpath.progress, 0.f,
+                       static_cast<float>(path.size()), "%.2f");
+    if (ImGui::Checkbox("Mount Tool", &toolpath.mount_tool)) {
+      toolpath.mounted_progress = -1.f;
+    }
+    if (path.has_orientation()) {
+      ImGui::SameLine();
+      ImGui::Text("5 axis");
+    }
+    ImGui::DragFloat("Max Error (px)", &toolpath.max_error_pixels, 0.05f,
+                     0.1f, 16.f);
+    ImGui::Text("%zu levels, %zu to %zu moves", toolpath.lod.levels.size(),
+                toolpath.lod.levels.back().index_count,
+                toolpath.lod.levels.front().index_count);
+  }
+  ImGui::End();
+}
+
+void render_stock_gui(internal::stock_view &stock) {
+  static const char *const formats[] = {"r32f", "r16f", "r16"};
+
+  ImGui::Begin("Stock");
+  ImGui::Checkbox("Visible", &stock.visible);
+  int format = static_cast<int>(stock.texture.format);
+  if (ImGui::Combo("Format", &format, formats, 3)) {
+    stock.texture.format = static_cast<glfw_impl::heightmap_format>(format);
+  }
+  ImGui::DragFloat("Edge (px)", &stock.draw.edge_pixels, 0.1f, 1.f, 64.f);
+  ImGui::DragFloat("Max Error (px)", &stock.draw.max_error_pixels, 0.05f,
+                   0.1f, 16.f);
+  ImGui::Text("%d x %d cells, %zu moves cut", stock.map.width,
+              stock.map.height, stock.cut_moves);
+  ImGui::Text("Quantization %.2g mm",
+              glfw_impl::quantization_error(stock.texture.format,
+                                            stock.texture.offset,
+                                            stock.texture.scale));
+  ImGui::End();
+}
+
 void render(input_state &input, interpolator_scene &scene) {
   render_performance_window();
   render_light_gui(scene.light);
   render_simulation_gui(scene.model);
+  render_toolpath_gui(scene.toolpath);
+  render_stock_gui(scene.stock);
   render_converter();
   render_popups();
 }
@@ -444,6 +525,11 @@ void render_popups() {
   ImVec2 center = ImGui::GetMainViewport()->GetCenter();
   ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
 
+  if (gui_info::show_file_error) {
+    ImGui::OpenPopup("File Corrupted");
+    gui_info::show_file_error = false;
+  }
+
   if (ImGui::BeginPopupModal("File Corrupted", NULL,
                              ImGuiWindowFlags_AlwaysAutoResize)) {
     ImGui::Text("The file you have pointed to is corrupted or wrongly "
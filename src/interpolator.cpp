@@ -13,7 +13,6 @@ bool interpolator::init(const std::string &window_title) {
   window = chosen_api::initialize(window_title, &input);
   final_result &= scene.init();
   final_result &= gui::init(window);
-  viewport.setup();
   return final_result;
 }
 
@@ -23,46 +22,37 @@ void interpolator::render_viewport() {
   static const glm::vec4 clear_color = {38.f / 255.f, 38.f / 255.f,
                                         38.f / 255.f, 1.00f};
 
+  scene.begin_frame();
+
+  // the target only reallocates when the panel outgrows its bucket
   ImGui::Begin("Quaternion Interpolation");
-  viewport.bind();
-  viewport.left = true;
   auto s = ImGui::GetContentRegionAvail();
-  if (viewport.width != s.x || viewport.height != s.y) {
-    viewport.width = s.x;
-    viewport.height = s.y;
-    viewport.setup();
-  }
-  viewport.set_left();
-  glViewport(0, 0, chosen_api::last_frame_info::left_viewport_area.x,
-             chosen_api::last_frame_info::left_viewport_area.y);
+  viewport.left.resize(s.x, s.y);
+  viewport.left.bind();
   chosen_api::clear_color_and_depth(clear_color, 1.f);
   scene.render(input, true);
-  GLuint t = viewport.color_left.value();
-  ImGui::Image((void *)(uint64_t)t, s, {0, 1}, {1, 0});
-  viewport.unbind();
+  viewport.left.unbind();
+  auto uv = viewport.left.uv_extent();
+  ImGui::Image((void *)(uint64_t)viewport.left.color.value(), s, {0, uv.y},
+               {uv.x, 0});
   ImGui::End();
 
   ImGui::Begin("Euler Angles Interpolation");
-  viewport.bind();
-  viewport.left = false;
   s = ImGui::GetContentRegionAvail();
-  if (viewport.width != s.x || viewport.height != s.y) {
-    viewport.width = s.x;
-    viewport.height = s.y;
-    viewport.setup();
-  }
-  viewport.set_right();
-  glViewport(0, 0, chosen_api::last_frame_info::right_viewport_area.x,
-             chosen_api::last_frame_info::right_viewport_area.y);
+  viewport.right.resize(s.x, s.y);
+  viewport.right.bind();
   chosen_api::clear_color_and_depth(clear_color, 1.f);
   scene.render(input, false);
-  viewport.unbind();
-  t = viewport.color_right.value();
-  ImGui::Image((void *)(uint64_t)t, s, {0, 1}, {1, 0});
+  viewport.right.unbind();
+  uv = viewport.right.uv_extent();
+  ImGui::Image((void *)(uint64_t)viewport.right.color.value(), s, {0, uv.y},
+               {uv.x, 0});
   ImGui::End();
 
   glViewport(0, 0, chosen_api::last_frame_info::width,
              chosen_api::last_frame_info::height);
+
+  scene.end_frame();
 }
 
 bool interpolator::main_loop() {
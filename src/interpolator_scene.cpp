@@ -1,41 +1,195 @@
 #include <interpolator_scene.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#include <new>
 #include <vector>
 
 #include <math.hpp>
 
-#include <mock_data.hpp>
 
 namespace pusn {
 
 void generate_milling_tool(api_agnostic_geometry &out) {}
 
+namespace {
+
+// executed moves and the rest of the path as two strips of the level whose
+// error stays below the pixel budget
+void render_toolpath(internal::toolpath_view &view, const input_state &input,
+                     float pixels_per_unit) {
+  if (!view.visible || !view.path.has_value() || view.path->empty()) {
+    return;
+  }
+  const auto &path = view.path.value();
+  const math::vec3 center = 0.5f * (path.bounds_min() + path.bounds_max());
+  const float radius =
+      0.5f * glm::length(path.bounds_max() - path.bounds_min());
+  const math::vec3 world_center =
+      math::vec3(view.model * math::vec4(center, 1.f));
+  const float distance =
+      std::max(glm::length(world_center - input.camera.pos) - radius,
+               input.render_info.clip_near);
+  const auto &level =
+      view.lod.select(view.max_error_pixels * distance / pixels_per_unit);
+
+  const auto moves = static_cast<std::size_t>(view.progress);
+  const std::size_t executed =
+      moves == 0 ? 0 : view.lod.prefix(level, moves - 1);
+  // the strips share the vertex where the tool left the executed part
+  const std::size_t rest_first = executed == 0 ? 0 : executed - 1;
+
+  glfw_impl::use_program(view.api_renderable.program.value());
+  glfw_impl::set_uniform(view.model_location, view.model);
+  if (executed >= 2) {
+    glfw_impl::set_uniform(view.color_location, view.executed_color);
+    glfw_impl::render(view.api_renderable, level.first_index, executed,
+                      glfw_impl::render_mode::line_strip);
+  }
+  if (level.index_count - rest_first >= 2) {
+    glfw_impl::set_uniform(view.color_location, view.remaining_color);
+    glfw_impl::render(view.api_renderable, level.first_index + rest_first,
+                      level.index_count - rest_first,
+                      glfw_impl::render_mode::line_strip);
+  }
+}
+
+// the tool at the program's progress, one placement per viewport. The
+// rotations come from the same batch kernel the milling engine samples.
+void mount_tool(internal::toolpath_view &view, internal::model &model) {
+  if (model.current_settings.has_value()) {
+    // a run owns the placements, mount again once it is over
+    view.mounted_progress = -1.f;
+    return;
+  }
+  if (!view.mount_tool || !view.path.has_value() || view.path->empty() ||
+      view.mounted_progress == view.progress) {
+    return;
+  }
+  const float s = view.tool_position();
+  const auto from =
+      std::min(static_cast<std::size_t>(s), view.path->size() - 1);
+  const auto to = std::min(from + 1, view.path->size() - 1);
+  const auto p0 = view.path->position(from);
+  const auto tip = p0 + (s - static_cast<float>(from)) *
+                            (view.path->position(to) - p0);
+  const auto frame = glm::quat_cast(math::mat3(view.model));
+
+  glm::quat rotation;
+  auto place = [&](std::vector<placement> &placements,
+                   orientation_method method) {
+    view.orientation.evaluate_batch(method, &s, 1, math::soa_ref(rotation));
+    placements.resize(1);
+    placements[0].position = math::vec3(view.model * math::vec4(tip, 1.f));
+    placements[0].rotation = frame * rotation;
+  };
+  place(model.left_placements, orientation_method::slerp);
+  place(model.right_placements, orientation_method::euler);
+  model.mark_placements_dirty();
+  view.mounted_progress = view.progress;
+}
+
+// brings the stock to the moves executed by the progress, a progress moved
+// back starts over from an uncut block
+void cut_stock(internal::stock_view &stock,
+               const internal::toolpath_view &view) {
+  if (!stock.visible) {
+    return;
+  }
+  if (!view.path.has_value()) {
+    glfw_impl::upload_heightmap(stock.texture, stock.map);
+    return;
+  }
+  const auto &path = view.path.value();
+  const auto moves =
+      std::min(static_cast<std::size_t>(view.progress), path.size());
+  if (moves < stock.cut_moves) {
+    stock.reset();
+  }
+  if (moves > stock.cut_moves) {
+    if (path.has_orientation()) {
+      milling::cut(stock.map, path.tool(), path, view.orientation,
+                   orientation_method::slerp, stock.cut_moves, moves);
+    } else {
+      milling::cut(stock.map, path.tool(), path, stock.cut_moves, moves);
+    }
+    stock.cut_moves = moves;
+  }
+  glfw_impl::upload_heightmap(stock.texture, stock.map);
+}
+
+} // namespace
+
+bool internal::toolpath_view::load(const std::filesystem::path &program) {
+  auto compiled = compiled_toolpath::load(program);
+  if (!compiled.has_value()) {
+    return false;
+  }
+  path = std::move(compiled);
+  lod = toolpath_decimation::build(path.value());
+  orientation.build(path.value());
+  glfw_impl::fill_renderable(path->x(), path->y(), path->z(), lod.indices,
+                             api_renderable);
+  progress = 0.f;
+  mounted_progress = -1.f;
+  LOGGER_INFO("[TOOLPATH] {0} levels, the coarsest with {1} moves",
+              lod.levels.size(), lod.levels.back().index_count);
+  return true;
+}
+
 bool interpolator_scene::init() {
   // Generate and add milling tool
-  mock_data::buildVerticesSmooth(100, model.height, model.radius,
-                                 model.geometry.vertices,
-                                 model.geometry.indices);
-  glfw_impl::fill_renderable(model.geometry.vertices, model.geometry.indices,
-                             model.api_renderable);
+  model.reset();
+  model.mesh_range = glfw_impl::add_to_arena(pack_mesh(model.mesh.geometry),
+                                             arena);
+  glfw_impl::upload_arena(arena);
   glfw_impl::add_program_to_renderable("resources/model", model.api_renderable);
+  glfw_impl::add_compute_program_to_renderable("resources/trajectory",
+                                               model.trajectory_program);
+  model.time_location = model.trajectory_program.uniform_location("time");
+  model.instance_count_location =
+      model.trajectory_program.uniform_location("instance_count");
 
   // ADD GRID
   glfw_impl::fill_renderable(grid.geometry.vertices, grid.geometry.indices,
                              grid.api_renderable);
   glfw_impl::add_program_to_renderable("resources/grid", grid.api_renderable);
+  grid.model_location = grid.api_renderable.uniform_location("model");
+
+  glfw_impl::add_program_to_renderable("resources/paths",
+                                       toolpath.api_renderable);
+  toolpath.model_location = toolpath.api_renderable.uniform_location("model");
+  toolpath.color_location = toolpath.api_renderable.uniform_location("color");
+
+  stock.reset();
+  glfw_impl::add_heightmap_program(stock.api_renderable);
+  glfw_impl::fill_heightmap_patches(stock.map, stock.api_renderable.patches);
 
   return true;
 }
 
-void interpolator_scene::set_light_uniforms(input_state &input,
-                                            glfw_impl::renderable &r) {
-  // set light and camera uniforms
-  glfw_impl::set_uniform("light_pos", r.program.value(),
-                         light.placement.position);
-  glfw_impl::set_uniform("light_color", r.program.value(), light.color);
-  glfw_impl::set_uniform("cam_pos", r.program.value(), input.camera.pos);
+void interpolator_scene::update_frame_uniforms(input_state &input,
+                                               const math::mat4 &view,
+                                               const math::mat4 &proj) {
+  const auto allocation =
+      glfw_impl::stream_allocate(stream, sizeof(glfw_impl::frame_uniforms));
+  new (allocation.data) glfw_impl::frame_uniforms{
+      view, proj, math::vec4(light.placement.position, 1.f),
+      math::vec4(light.color, 1.f), math::vec4(input.camera.pos, 1.f)};
+  glfw_impl::bind_stream_range(stream, allocation, GL_UNIFORM_BUFFER,
+                               glfw_impl::frame_uniforms::binding);
+}
+
+void interpolator_scene::begin_frame() {
+  glfw_impl::begin_stream_frame(stream);
+  // once for both viewports
+  cut_stock(stock, toolpath);
 }
 
+void interpolator_scene::end_frame() { glfw_impl::end_stream_frame(stream); }
+
 void interpolator_scene::render(input_state &input, bool left) {
 
   // 1. get camera info
@@ -52,132 +206,183 @@ void interpolator_scene::render(input_state &input, bool left) {
            : glfw_impl::last_frame_info::right_viewport_area.y,
       input.render_info.clip_near, input.render_info.clip_far);
 
+  update_frame_uniforms(input, view, proj);
+
+  // size of a unit at distance 1, for the level of detail selection
+  const float viewport_height =
+      left ? glfw_impl::last_frame_info::left_viewport_area.y
+           : glfw_impl::last_frame_info::right_viewport_area.y;
+  const float pixels_per_unit =
+      0.5f * viewport_height /
+      std::tan(0.5f * glm::radians(input.render_info.fov_y));
+
   // 2. render grid
   glDisable(GL_CULL_FACE);
   const auto model_grid_m =
       math::get_model_matrix(grid.placement.position, grid.placement.scale,
                              math::deg_to_rad(grid.placement.rotation));
   glfw_impl::use_program(grid.api_renderable.program.value());
-
-  set_light_uniforms(input, grid.api_renderable);
-
-  glfw_impl::set_uniform("model", grid.api_renderable.program.value(),
-                         model_grid_m);
-  glfw_impl::set_uniform("view", grid.api_renderable.program.value(), view);
-  glfw_impl::set_uniform("proj", grid.api_renderable.program.value(), proj);
+  glfw_impl::set_uniform(grid.model_location, model_grid_m);
   glfw_impl::render(grid.api_renderable, grid.geometry);
+
+  // 2b. render the loaded program and the stock it cuts
+  render_toolpath(toolpath, input, pixels_per_unit);
+  if (stock.visible) {
+    // in program coordinates like the toolpath
+    stock.draw.model = toolpath.model;
+    stock.draw.viewport = left
+                              ? glfw_impl::last_frame_info::left_viewport_area
+                              : glfw_impl::last_frame_info::right_viewport_area;
+    glfw_impl::render_heightmap(stock.api_renderable, stock.texture, stock.map,
+                                stock.draw);
+  }
   glEnable(GL_CULL_FACE);
 
   // 3. render the model
+  mount_tool(toolpath, model);
   const auto time = std::chrono::system_clock::now();
+  float progress = 0.f;
   if (model.current_settings.has_value()) {
 
     std::chrono::duration<float> elapsed_seconds =
         time - model.current_settings.value().start_time;
-    const float progress =
-        elapsed_seconds.count() / model.current_settings.value().length;
+    progress = elapsed_seconds.count() / model.current_settings.value().length;
 
     if (progress > 1.0) {
+      // leave the final pose in the placements for the static path, the gpu
+      // and the rigid motions never wrote it there
+      const float end = 1.f;
+      model.left_placements.resize(1);
+      model.right_placements.resize(1);
+      model.evaluators.left(model.current_settings.value(), model.cache, &end,
+                            1, model.left_placements.data());
+      model.evaluators.right(model.current_settings.value(), model.cache,
+                             &end, 1, model.right_placements.data());
+      model.mark_placements_dirty();
+      model.gpu_animated = false;
       model.current_settings.reset();
-    } else {
-      model.left_placements.clear();
-      model.right_placements.clear();
-      // left (quaternion)
-      scene_object_info curr;
-      curr.position =
-          (1 - progress) * model.current_settings.value().position_start +
-          progress * model.current_settings.value().position_end;
-
-      if (model.current_settings.value().slerp) {
-        curr.rotation =
-            glm::degrees(glm::eulerAngles(glm::normalize(math::slerp(
-                model.current_settings.value().quat_rotation_start,
-                model.current_settings.value().quat_rotation_end, progress))));
-      } else {
-        curr.rotation = glm::degrees(glm::eulerAngles(glm::normalize(math::lerp(
-            model.current_settings.value().quat_rotation_start,
-            model.current_settings.value().quat_rotation_end, progress))));
+    } else if (!model.gpu_animated) {
+      model.left_placements.resize(1);
+      model.right_placements.resize(1);
+      // left (quaternion), the rigid motions write the matrices below
+      if (model.evaluators.left_affine == nullptr) {
+        model.evaluators.left(model.current_settings.value(), model.cache,
+                              &progress, 1, model.left_placements.data());
       }
-
-      model.left_placements.push_back(curr);
-
       // right (euler angles)
-      // 1. check if reversed will be needed
-      auto eu_st = model.current_settings.value().euler_rotation_start;
-      auto eu_en = model.current_settings.value().euler_rotation_end;
-
-      const float pi = glm::pi<float>();
-      const float tau = 2 * glm::pi<float>();
-
-      eu_st = {std::fmod(eu_st.x, tau), std::fmod(eu_st.y, tau),
-               std::fmod(eu_st.z, tau)};
-
-      eu_en = {std::fmod(eu_en.x, tau), std::fmod(eu_en.y, tau),
-               std::fmod(eu_en.z, tau)};
-
-      const auto dist = eu_en - eu_st;
-
-      if (std::abs(dist.x) > pi) {
-        if (eu_en.x > eu_st.x) {
-          eu_st.x += tau;
-        } else {
-          eu_en.x += tau;
-        }
-      }
-      if (std::abs(dist.y) > pi) {
-        if (eu_en.y > eu_st.y) {
-          eu_st.y += tau;
-        } else {
-          eu_en.y += tau;
-        }
-      }
-      if (std::abs(dist.z) > pi) {
-        if (eu_en.z > eu_st.z) {
-          eu_st.z += tau;
-        } else {
-          eu_en.z += tau;
-        }
-      }
-
-      curr.rotation = glm::degrees(glm::mix(eu_st, eu_en, progress));
-      model.right_placements.push_back(curr);
+      model.evaluators.right(model.current_settings.value(), model.cache,
+                             &progress, 1, model.right_placements.data());
     }
   }
 
-  if (left) {
-    for (auto &placement : model.left_placements) {
-      const auto model_model_m =
-          math::get_model_matrix(placement.position, placement.scale,
-                                 math::deg_to_rad(placement.rotation));
-      glfw_impl::use_program(model.api_renderable.program.value());
-      set_light_uniforms(input, model.api_renderable);
-      glfw_impl::set_uniform("model", model.api_renderable.program.value(),
-                             model_model_m);
-      glfw_impl::set_uniform("view", model.api_renderable.program.value(),
-                             view);
-      glfw_impl::set_uniform("proj", model.api_renderable.program.value(),
-                             proj);
-      glfw_impl::render(model.api_renderable, model.geometry);
-
-      glfw_impl::use_program(0);
+  auto &placements = left ? model.left_placements : model.right_placements;
+  auto &instances = left ? model.left_instances : model.right_instances;
+  std::size_t instance_count = placements.size();
+  if (model.current_settings.has_value() && model.gpu_animated) {
+    // only the time goes to the gpu, trajectory.comp writes the transforms
+    auto &motions = left ? model.left_motions : model.right_motions;
+    const std::chrono::duration<float> elapsed =
+        time - model.current_settings.value().start_time;
+    glfw_impl::use_program(model.trajectory_program.program.value());
+    glfw_impl::set_uniform(model.time_location, elapsed.count());
+    glfw_impl::set_uniform(model.instance_count_location,
+                           static_cast<GLuint>(motions.count));
+    glfw_impl::bind_storage_buffer(motions.transforms, 0);
+    glfw_impl::bind_storage_buffer(motions.motions, 1);
+    glfw_impl::dispatch_compute(motions.count, 64);
+    instance_count = motions.count;
+    instances.dirty = true;
+  } else if (model.current_settings.has_value()) {
+    // animated, compose straight into the mapped stream
+    const auto allocation = glfw_impl::stream_allocate(
+        stream, sizeof(math::affine_transform) * instance_count);
+    auto *transforms =
+        reinterpret_cast<math::affine_transform *>(allocation.data);
+    if (left && model.evaluators.left_affine != nullptr) {
+      // the blended dual quaternions become the matrices, the level of
+      // detail below only needs their translation
+      model.evaluators.left_affine(model.current_settings.value(),
+                                   model.cache, &progress, instance_count,
+                                   transforms);
+      for (std::size_t i = 0; i < instance_count; ++i) {
+        placements[i].position =
+            math::vec3(transforms[i].model[0].w, transforms[i].model[1].w,
+                       transforms[i].model[2].w);
+      }
+    } else {
+      math::compose_affine_batch(placements.data(), instance_count,
+                                 transforms);
     }
+    glfw_impl::bind_stream_range(stream, allocation, GL_SHADER_STORAGE_BUFFER,
+                                 0);
+    instances.dirty = true;
   } else {
-    for (auto &placement : model.right_placements) {
-      const auto model_model_m =
-          math::get_model_matrix(placement.position, placement.scale,
-                                 math::deg_to_rad(placement.rotation));
-      glfw_impl::use_program(model.api_renderable.program.value());
-      set_light_uniforms(input, model.api_renderable);
-      glfw_impl::set_uniform("model", model.api_renderable.program.value(),
-                             model_model_m);
-      glfw_impl::set_uniform("view", model.api_renderable.program.value(),
-                             view);
-      glfw_impl::set_uniform("proj", model.api_renderable.program.value(),
-                             proj);
-      glfw_impl::render(model.api_renderable, model.geometry);
-
-      glfw_impl::use_program(0);
+    if (instances.dirty) {
+      instances.transforms.resize(instance_count);
+      math::compose_affine_batch(placements.data(), instance_count,
+                                 instances.transforms.data());
+      glfw_impl::fill_buffer(
+          instances.transforms.data(),
+          sizeof(math::affine_transform) * instance_count, instances.buffer);
+      instances.dirty = false;
     }
+    glfw_impl::bind_storage_buffer(instances.buffer, 0);
+  }
+
+  // bucket the instances by level of detail, one indirect command per level.
+  // model.vert reads its transform through the id list, so the transforms
+  // keep their order whichever path wrote them.
+  const auto &lods = model.mesh.lods;
+  if (instance_count == 0 || placements.empty()) {
+    return;
   }
+  // gpu animated instances beyond the placements share the last one's level
+  const std::size_t lod_samples =
+      std::min(placements.size(), instance_count);
+  std::vector<std::uint8_t> &instance_lods = model.instance_lods;
+  instance_lods.resize(instance_count);
+  std::vector<GLuint> lod_offsets(lods.size() + 1, 0);
+  for (std::size_t i = 0; i < instance_count; ++i) {
+    const auto &p = placements[std::min(i, lod_samples - 1)];
+    const float distance =
+        std::max(glm::length(p.position - input.camera.pos) -
+                     model.mesh.bounding_radius,
+                 input.render_info.clip_near);
+    const auto &lod =
+        model.mesh.select_lod(model.mesh.radius * pixels_per_unit / distance);
+    instance_lods[i] = static_cast<std::uint8_t>(&lod - lods.data());
+    ++lod_offsets[instance_lods[i] + 1];
+  }
+  for (std::size_t l = 0; l < lods.size(); ++l) {
+    lod_offsets[l + 1] += lod_offsets[l];
+  }
+
+  const auto ids = glfw_impl::stream_allocate(stream, sizeof(GLuint) *
+                                                          instance_count);
+  auto *id_data = reinterpret_cast<GLuint *>(ids.data);
+  std::vector<GLuint> fill(lod_offsets.begin(), lod_offsets.end() - 1);
+  for (std::size_t i = 0; i < instance_count; ++i) {
+    id_data[fill[instance_lods[i]]++] = static_cast<GLuint>(i);
+  }
+  glfw_impl::bind_stream_range(stream, ids, GL_SHADER_STORAGE_BUFFER, 2);
+
+  const auto commands = glfw_impl::stream_allocate(
+      stream, sizeof(glfw_impl::draw_elements_indirect_command) * lods.size());
+  auto *command_data =
+      reinterpret_cast<glfw_impl::draw_elements_indirect_command *>(
+          commands.data);
+  for (std::size_t l = 0; l < lods.size(); ++l) {
+    command_data[l] = {static_cast<GLuint>(lods[l].index_count),
+                       lod_offsets[l + 1] - lod_offsets[l],
+                       model.mesh_range.first_index +
+                           static_cast<GLuint>(lods[l].first_index),
+                       model.mesh_range.base_vertex, lod_offsets[l]};
+  }
+
+  // every placement of every level in a single submission, see model.vert
+  glfw_impl::use_program(model.api_renderable.program.value());
+  glfw_impl::render_indirect(arena.meta, stream.value(), commands.offset,
+                             lods.size());
+  glfw_impl::use_program(0);
 }
 } // namespace pusn
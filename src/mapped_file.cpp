@@ -0,0 +1,132 @@
+#include <mapped_file.hpp>
+
+#include <utility>
+
+#include <logger.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pusn {
+namespace utils {
+
+mapped_file::mapped_file(mapped_file &&other) noexcept { *this = std::move(other); }
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept {
+  if (this != &other) {
+    reset();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+    mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+  }
+  return *this;
+}
+
+mapped_file::~mapped_file() { reset(); }
+
+#ifdef _WIN32
+
+void mapped_file::reset() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  mapping_ = nullptr;
+}
+
+std::optional<mapped_file> mapped_file::open(const std::filesystem::path &path) {
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    LOGGER_ERROR("[FILE] Could not open {0}", path.string());
+    return std::nullopt;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    LOGGER_ERROR("[FILE] Could not stat {0}", path.string());
+    return std::nullopt;
+  }
+
+  mapped_file out;
+  if (size.QuadPart > 0) {
+    out.mapping_ =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (out.mapping_ != nullptr) {
+      out.data_ = static_cast<const char *>(
+          MapViewOfFile(out.mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (out.data_ == nullptr) {
+      CloseHandle(file);
+      LOGGER_ERROR("[FILE] Could not map {0}", path.string());
+      return std::nullopt;
+    }
+    out.size_ = static_cast<std::size_t>(size.QuadPart);
+  }
+  CloseHandle(file);
+  LOGGER_INFO("[FILE] Mapped {0} bytes from {1}", out.size_, path.string());
+  return out;
+}
+
+#else
+
+void mapped_file::reset() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+std::optional<mapped_file> mapped_file::open(const std::filesystem::path &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOGGER_ERROR("[FILE] Could not open {0}", path.string());
+    return std::nullopt;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    LOGGER_ERROR("[FILE] Could not stat {0}", path.string());
+    return std::nullopt;
+  }
+
+  mapped_file out;
+  if (st.st_size > 0) {
+    void *data = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ,
+                      MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      LOGGER_ERROR("[FILE] Could not map {0}", path.string());
+      return std::nullopt;
+    }
+    // read front to back once
+    madvise(data, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+    out.data_ = static_cast<const char *>(data);
+    out.size_ = static_cast<std::size_t>(st.st_size);
+  }
+  // the mapping keeps the file alive
+  close(fd);
+  LOGGER_INFO("[FILE] Mapped {0} bytes from {1}", out.size_, path.string());
+  return out;
+}
+
+#endif
+
+} // namespace utils
+} // namespace pusn
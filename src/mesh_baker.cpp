@@ -0,0 +1,225 @@
+#include <mesh_baker.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <type_traits>
+
+#include <logger.hpp>
+#include <mock_data.hpp>
+#include <utils.hpp>
+#include <vertex_format.hpp>
+
+namespace pusn {
+
+namespace {
+
+// bump whenever the generator or the blob layout changes
+constexpr std::uint32_t cache_version = 3;
+constexpr char cache_magic[4] = {'P', 'M', 'S', 'H'};
+
+struct blob_header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t lod_count;
+  std::uint32_t vertex_count;
+  std::uint32_t index_count;
+  float radius;
+  float bounding_radius;
+};
+
+struct blob_lod {
+  std::int32_t sectors;
+  std::uint32_t first_index;
+  std::uint32_t index_count;
+};
+
+static_assert(std::is_trivially_copyable_v<pos_norm_col>);
+
+// fnv-1a over the version and the generator parameters
+std::uint64_t cache_key(float height, float radius) {
+  auto hash = utils::fnv1a(nullptr, 0);
+  auto mix = [&](std::uint32_t value) {
+    hash = utils::fnv1a(&value, sizeof(value), hash);
+  };
+  mix(cache_version);
+  mix(std::bit_cast<std::uint32_t>(height));
+  mix(std::bit_cast<std::uint32_t>(radius));
+  for (const int sectors : mesh_baker::tool_lod_sectors) {
+    mix(static_cast<std::uint32_t>(sectors));
+  }
+  return hash;
+}
+
+std::filesystem::path cache_path(const std::filesystem::path &cache_dir,
+                                 float height, float radius) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "tool_%016llx.mesh",
+                static_cast<unsigned long long>(cache_key(height, radius)));
+  return cache_dir / name;
+}
+
+template <typename T>
+bool read_array(std::ifstream &ifs, std::vector<T> &out, std::size_t count) {
+  out.resize(count);
+  ifs.read(reinterpret_cast<char *>(out.data()),
+           static_cast<std::streamsize>(sizeof(T) * count));
+  return static_cast<bool>(ifs);
+}
+
+bool load_blob(const std::filesystem::path &path, baked_mesh &out) {
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs) {
+    return false;
+  }
+  blob_header header;
+  ifs.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!ifs || !std::equal(header.magic, header.magic + 4, cache_magic) ||
+      header.version != cache_version) {
+    return false;
+  }
+
+  // filled aside, a truncated or damaged blob leaves out untouched
+  baked_mesh mesh;
+  std::vector<blob_lod> lods;
+  if (!read_array(ifs, lods, header.lod_count) ||
+      !read_array(ifs, mesh.geometry.vertices, header.vertex_count) ||
+      !read_array(ifs, mesh.geometry.indices, header.index_count)) {
+    return false;
+  }
+  for (const auto index : mesh.geometry.indices) {
+    if (index >= header.vertex_count) {
+      return false;
+    }
+  }
+
+  mesh.lods.reserve(lods.size());
+  for (const auto &lod : lods) {
+    if (lod.first_index > header.index_count ||
+        lod.index_count > header.index_count - lod.first_index) {
+      return false;
+    }
+    mesh.lods.push_back({lod.sectors, lod.first_index, lod.index_count});
+  }
+  if (mesh.lods.empty()) {
+    return false;
+  }
+  mesh.radius = header.radius;
+  mesh.bounding_radius = header.bounding_radius;
+  out = std::move(mesh);
+  return true;
+}
+
+void store_blob(const std::filesystem::path &path, const baked_mesh &mesh) {
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  // written aside and renamed so a reader never loads a partial blob
+  auto partial = path;
+  partial += ".part";
+  {
+    std::ofstream ofs(partial, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      LOGGER_WARN("[MESH] Could not write cache {0}", partial.string());
+      return;
+    }
+
+    blob_header header{
+        {cache_magic[0], cache_magic[1], cache_magic[2], cache_magic[3]},
+        cache_version,
+        static_cast<std::uint32_t>(mesh.lods.size()),
+        static_cast<std::uint32_t>(mesh.geometry.vertices.size()),
+        static_cast<std::uint32_t>(mesh.geometry.indices.size()),
+        mesh.radius,
+        mesh.bounding_radius};
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto &lod : mesh.lods) {
+      const blob_lod out{lod.sectors,
+                         static_cast<std::uint32_t>(lod.first_index),
+                         static_cast<std::uint32_t>(lod.index_count)};
+      ofs.write(reinterpret_cast<const char *>(&out), sizeof(out));
+    }
+    ofs.write(reinterpret_cast<const char *>(mesh.geometry.vertices.data()),
+              sizeof(pos_norm_col) * mesh.geometry.vertices.size());
+    ofs.write(reinterpret_cast<const char *>(mesh.geometry.indices.data()),
+              sizeof(unsigned int) * mesh.geometry.indices.size());
+    if (!ofs) {
+      LOGGER_WARN("[MESH] Could not write cache {0}", partial.string());
+      return;
+    }
+  }
+  std::filesystem::rename(partial, path, ec);
+  if (ec) {
+    LOGGER_WARN("[MESH] Could not write cache {0}", path.string());
+  }
+}
+
+} // namespace
+
+const mesh_lod &baked_mesh::select_lod(float projected_radius,
+                                       float max_edge_pixels) const {
+  // a sector edge of the rim is about 2 pi r / sectors pixels long
+  const float needed =
+      2.f * glm::pi<float>() * projected_radius / max_edge_pixels;
+  for (std::size_t i = lods.size(); i-- > 1;) {
+    if (static_cast<float>(lods[i].sectors) >= needed) {
+      return lods[i];
+    }
+  }
+  return lods.front();
+}
+
+baked_mesh mesh_baker::bake_tool(float height, float radius,
+                                 const std::filesystem::path &cache_dir) {
+  baked_mesh mesh;
+  const auto path = cache_path(cache_dir, height, radius);
+  if (load_blob(path, mesh)) {
+    LOGGER_INFO("[MESH] Loaded {0} levels from {1}", mesh.lods.size(),
+                path.string());
+    return mesh;
+  }
+
+  // 4 * (sectors + 1) vertices and 12 * sectors indices per cylinder
+  std::size_t vertex_count = 0;
+  std::size_t index_count = 0;
+  for (const int sectors : tool_lod_sectors) {
+    vertex_count += 3 * 4 * (sectors + 1);
+    index_count += 3 * 12 * sectors;
+  }
+  mesh.geometry.vertices.reserve(vertex_count);
+  mesh.geometry.indices.reserve(index_count);
+
+  std::vector<pos_norm_col> vertices;
+  std::vector<unsigned int> indices;
+  for (const int sectors : tool_lod_sectors) {
+    vertices.clear();
+    indices.clear();
+    mock_data::buildVerticesSmooth(sectors, height, radius, vertices, indices);
+    indices = optimize_vertex_cache(indices, vertices.size());
+
+    const auto base = static_cast<unsigned int>(mesh.geometry.vertices.size());
+    mesh.lods.push_back(
+        {sectors, mesh.geometry.indices.size(), indices.size()});
+    mesh.geometry.vertices.insert(mesh.geometry.vertices.end(),
+                                  vertices.begin(), vertices.end());
+    for (const auto index : indices) {
+      mesh.geometry.indices.push_back(base + index);
+    }
+  }
+
+  mesh.radius = radius;
+  mesh.bounding_radius = 0.f;
+  for (const auto &vertex : mesh.geometry.vertices) {
+    mesh.bounding_radius =
+        std::max(mesh.bounding_radius, glm::length(vertex.pos));
+  }
+
+  store_blob(path, mesh);
+  LOGGER_INFO("[MESH] Baked {0} levels into {1}", mesh.lods.size(),
+              path.string());
+  return mesh;
+}
+
+} // namespace pusn
@@ -0,0 +1,394 @@
+#include <milling.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace pusn {
+
+namespace {
+
+// a segment with what every cell of it needs precomputed
+struct segment {
+  // start of the tool's reference point, ball centre or flat tip, and the
+  // motion to the end
+  float x0, y0, z0;
+  float dx, dy, dz;
+  // squared horizontal and full lengths of the motion and their inverses
+  float dxy2, dd;
+  float inv_dxy2, inv_dd;
+  // no horizontal motion, the tool only plunges or retracts
+  bool vertical;
+  // cells covered by the swept footprint
+  heightmap_region cells;
+};
+
+// x interval of the footprint, a stadium around the horizontal motion, on
+// the row at qy. The stadium is convex so the hull of the end discs and of
+// the band between them is the whole interval.
+inline bool row_span(const segment &s, float r, float qy, float &lo,
+                     float &hi) {
+  lo = std::numeric_limits<float>::infinity();
+  hi = -lo;
+  const auto disc = [&](float cx, float cy) {
+    const float h = r * r - (qy - cy) * (qy - cy);
+    if (h >= 0.f) {
+      const float w = std::sqrt(h);
+      lo = std::min(lo, cx - w);
+      hi = std::max(hi, cx + w);
+    }
+  };
+  disc(s.x0, s.y0);
+  disc(s.x0 + s.dx, s.y0 + s.dy);
+  if (!s.vertical) {
+    // |cross(d, p - p0)| <= r |d| and 0 <= dot(d, p - p0) <= |d|^2, both
+    // linear in x along the row
+    float band_lo = -std::numeric_limits<float>::infinity();
+    float band_hi = -band_lo;
+    const auto clip = [&](float k, float c, float min, float max) {
+      // min <= k x + c <= max
+      if (std::abs(k) < 1e-12f) {
+        if (c < min || c > max) {
+          band_lo = std::numeric_limits<float>::infinity();
+        }
+        return;
+      }
+      const float a = (min - c) / k;
+      const float b = (max - c) / k;
+      band_lo = std::max(band_lo, std::min(a, b));
+      band_hi = std::min(band_hi, std::max(a, b));
+    };
+    const float ry = qy - s.y0;
+    const float width = r * std::sqrt(s.dxy2);
+    clip(-s.dy, s.dx * ry + s.dy * s.x0, -width, width);
+    clip(s.dx, s.dy * ry - s.dx * s.x0, 0.f, s.dxy2);
+    if (band_lo <= band_hi) {
+      lo = std::min(lo, band_lo);
+      hi = std::max(hi, band_hi);
+    }
+  }
+  return lo <= hi;
+}
+
+// by value min and max, std::min and std::max return references that keep
+// the simd loops below from vectorizing
+inline float select_min(float a, float b) { return b < a ? b : a; }
+inline float select_max(float a, float b) { return b > a ? b : a; }
+
+// lowest point of the ball swept along the motion on the vertical line
+// through the cell. The bottom of the ball is convex in the motion's
+// parameter, so it is reached where the line meets the cylinder around the
+// motion or, past its ends, on the nearer end sphere.
+template <bool Vertical>
+inline float ball_bottom(const segment &s, float r2, float wx, float wy) {
+  const float h0 = wx * wx + wy * wy;
+  float t;
+  if constexpr (Vertical) {
+    t = s.dz < 0.f ? 1.f : 0.f;
+  } else {
+    // |w - (w.d / d.d) d|^2 = r^2 with w = (wx, wy, wz), solved for wz
+    const float u = wx * s.dx + wy * s.dy;
+    const float b = u * s.dz;
+    const float c = s.dd * (h0 - r2) - u * u;
+    const float disc = select_max(0.f, b * b - s.dxy2 * c);
+    const float wz = (b - std::sqrt(disc)) * s.inv_dxy2;
+    t = select_min(1.f, select_max(0.f, (u + wz * s.dz) * s.inv_dd));
+  }
+  const float hx = wx - t * s.dx;
+  const float hy = wy - t * s.dy;
+  const float h = r2 - (hx * hx + hy * hy);
+  return h >= 0.f ? s.z0 + t * s.dz - std::sqrt(h)
+                  : std::numeric_limits<float>::infinity();
+}
+
+// lowest tip of the flat end whose disc covers the cell, the tip height is
+// linear along the motion so it is one end of the covered interval
+template <bool Vertical>
+inline float flat_bottom(const segment &s, float r2, float wx, float wy) {
+  const float h0 = wx * wx + wy * wy;
+  if constexpr (Vertical) {
+    return h0 <= r2 ? s.z0 + select_min(0.f, s.dz)
+                    : std::numeric_limits<float>::infinity();
+  }
+  // |w - t d|^2 <= r^2
+  const float u = wx * s.dx + wy * s.dy;
+  const float disc = u * u - s.dxy2 * (h0 - r2);
+  const float root = std::sqrt(select_max(0.f, disc));
+  const float t0 = select_max(0.f, (u - root) * s.inv_dxy2);
+  const float t1 = select_min(1.f, (u + root) * s.inv_dxy2);
+  return disc >= 0.f && t0 <= t1 ? s.z0 + (s.dz < 0.f ? t1 : t0) * s.dz
+                                 : std::numeric_limits<float>::infinity();
+}
+
+// one row of a segment, without branches so it runs on simd lanes
+template <tool_type Type, bool Vertical>
+void cut_row(const segment s, float r2, float *row, int x0, int x1, float wx0,
+             float step, float wy) {
+#pragma omp simd
+  for (int x = x0; x < x1; ++x) {
+    const float wx = wx0 + x * step;
+    const float bottom = Type == tool_type::ball
+                             ? ball_bottom<Vertical>(s, r2, wx, wy)
+                             : flat_bottom<Vertical>(s, r2, wx, wy);
+    row[x] = select_min(row[x], bottom);
+  }
+}
+
+template <tool_type Type>
+void cut_tile(heightmap &map, const std::vector<segment> &segments,
+              const std::uint32_t *ids, std::size_t count, float r,
+              const heightmap_region &tile) {
+  const float r2 = r * r;
+  for (std::size_t k = 0; k < count; ++k) {
+    const auto &s = segments[ids[k]];
+    const int y0 = std::max(tile.y0, s.cells.y0);
+    const int y1 = std::min(tile.y1, s.cells.y1);
+    for (int y = y0; y < y1; ++y) {
+      const float qy = map.origin.y + (y + 0.5f) * map.cell_size.y;
+      float lo, hi;
+      if (!row_span(s, r, qy, lo, hi)) {
+        continue;
+      }
+      // cells whose centre lies in [lo, hi]
+      const int x0 = std::max(
+          tile.x0, static_cast<int>(std::ceil(
+                       (lo - map.origin.x) / map.cell_size.x - 0.5f)));
+      const int x1 = std::min(
+          tile.x1, static_cast<int>(std::floor(
+                       (hi - map.origin.x) / map.cell_size.x - 0.5f)) +
+                       1);
+      const float wy = qy - s.y0;
+      const float wx0 = map.origin.x + 0.5f * map.cell_size.x - s.x0;
+      float *row = &map.at(0, y);
+      if (s.vertical) {
+        cut_row<Type, true>(s, r2, row, x0, x1, wx0, map.cell_size.x, wy);
+      } else {
+        cut_row<Type, false>(s, r2, row, x0, x1, wx0, map.cell_size.x, wy);
+      }
+    }
+  }
+}
+
+// the segment of the reference point from p0 to p1, false when its
+// footprint misses the map
+bool make_segment(const heightmap &map, float r, const math::vec3 &p0,
+                  const math::vec3 &p1, segment &s) {
+  s.x0 = p0.x;
+  s.y0 = p0.y;
+  s.z0 = p0.z;
+  s.dx = p1.x - s.x0;
+  s.dy = p1.y - s.y0;
+  s.dz = p1.z - s.z0;
+  s.dxy2 = s.dx * s.dx + s.dy * s.dy;
+  s.dd = s.dxy2 + s.dz * s.dz;
+  // nearly vertical motions are plunges, the cylinder around them is
+  // degenerate
+  s.vertical = s.dxy2 <= 1e-8f * s.dd || s.dxy2 <= 1e-12f;
+  s.inv_dxy2 = s.vertical ? 0.f : 1.f / s.dxy2;
+  s.inv_dd = s.dd > 0.f ? 1.f / s.dd : 0.f;
+
+  const auto cell = [&](float v, float origin, float size) {
+    return static_cast<int>(std::floor((v - origin) / size));
+  };
+  s.cells.x0 = std::max(0, cell(std::min(s.x0, s.x0 + s.dx) - r,
+                                map.origin.x, map.cell_size.x));
+  s.cells.x1 = std::min(map.width, cell(std::max(s.x0, s.x0 + s.dx) + r,
+                                        map.origin.x, map.cell_size.x) +
+                                       1);
+  s.cells.y0 = std::max(0, cell(std::min(s.y0, s.y0 + s.dy) - r,
+                                map.origin.y, map.cell_size.y));
+  s.cells.y1 = std::min(map.height, cell(std::max(s.y0, s.y0 + s.dy) + r,
+                                         map.origin.y, map.cell_size.y) +
+                                        1);
+  return !s.cells.empty();
+}
+
+// bins the segments by tile and cuts the tiles in parallel
+void cut_segments(heightmap &map, tool_type type, float r,
+                  const std::vector<segment> &segments) {
+  constexpr int tile_size = heightmap::tile_size;
+  const int tiles_x = map.tiles_x();
+  const int tiles_y = map.tiles_y();
+  const std::size_t tile_count = static_cast<std::size_t>(tiles_x) * tiles_y;
+  if (map.dirty_tiles.size() != tile_count) {
+    map.mark_dirty();
+  }
+  if (map.tile_variance.size() != tile_count) {
+    map.measure();
+  }
+
+  // segments of every tile, counted and then filled in place
+  std::vector<std::uint32_t> offsets(tile_count + 1, 0);
+  auto for_each_tile = [&](const segment &s, auto &&f) {
+    for (int ty = s.cells.y0 / tile_size; ty <= (s.cells.y1 - 1) / tile_size;
+         ++ty) {
+      for (int tx = s.cells.x0 / tile_size;
+           tx <= (s.cells.x1 - 1) / tile_size; ++tx) {
+        f(static_cast<std::size_t>(ty) * tiles_x + tx);
+      }
+    }
+  };
+  for (const auto &s : segments) {
+    for_each_tile(s, [&](std::size_t t) { ++offsets[t + 1]; });
+  }
+  for (std::size_t t = 0; t < tile_count; ++t) {
+    offsets[t + 1] += offsets[t];
+  }
+  std::vector<std::uint32_t> ids(offsets.back());
+  {
+    std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+      for_each_tile(segments[i], [&](std::size_t t) {
+        ids[fill[t]++] = static_cast<std::uint32_t>(i);
+      });
+    }
+  }
+
+  // tiles own disjoint cells, the busy ones along the path take longest
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (std::int64_t t = 0; t < static_cast<std::int64_t>(tile_count); ++t) {
+    const std::size_t count = offsets[t + 1] - offsets[t];
+    if (count == 0) {
+      continue;
+    }
+    map.dirty_tiles[t] = 1;
+    const int tx = static_cast<int>(t % tiles_x);
+    const int ty = static_cast<int>(t / tiles_x);
+    const auto tile = map.tile_region(tx, ty);
+    if (type == tool_type::ball) {
+      cut_tile<tool_type::ball>(map, segments, ids.data() + offsets[t], count,
+                                r, tile);
+    } else {
+      cut_tile<tool_type::flat>(map, segments, ids.data() + offsets[t], count,
+                                r, tile);
+    }
+    // still in the cache of the thread that cut it
+    map.measure_tile(tx, ty);
+  }
+}
+
+} // namespace
+
+heightmap milling::make_heightmap(const material_block &block) {
+  heightmap out;
+  out.width = block.resolution_x;
+  out.height = block.resolution_y;
+  out.origin = {-0.5f * block.size.x, -0.5f * block.size.y};
+  out.cell_size = {block.size.x / block.resolution_x,
+                   block.size.y / block.resolution_y};
+  out.heights.assign(static_cast<std::size_t>(out.width) * out.height,
+                     block.size.z);
+  out.mark_dirty();
+  // flat everywhere
+  out.tile_variance.assign(out.dirty_tiles.size(), 0.f);
+  return out;
+}
+
+heightmap_region milling::cut(heightmap &map, const tool_info &tool,
+                              const compiled_toolpath &path, std::size_t first,
+                              std::size_t last) {
+  first = std::max<std::size_t>(first, 1);
+  last = std::min(last, path.size());
+  if (first >= last || map.width <= 0 || map.height <= 0) {
+    return {};
+  }
+
+  const float r = 0.5f * tool.diameter;
+  // the ball is followed by its centre, a radius above the tip
+  const math::vec3 lift{0.f, 0.f, tool.type == tool_type::ball ? r : 0.f};
+  std::vector<segment> segments;
+  segments.reserve(last - first);
+  heightmap_region touched;
+  for (std::size_t i = first; i < last; ++i) {
+    segment s;
+    if (make_segment(map, r, path.position(i - 1) + lift,
+                     path.position(i) + lift, s)) {
+      touched.merge(s.cells);
+      segments.push_back(s);
+    }
+  }
+  cut_segments(map, tool.type, r, segments);
+  return touched;
+}
+
+heightmap_region milling::cut(heightmap &map, const tool_info &tool,
+                              const compiled_toolpath &path,
+                              const orientation_track &orientation,
+                              orientation_method method, std::size_t first,
+                              std::size_t last) {
+  if (tool.type != tool_type::ball || !path.has_orientation() ||
+      orientation.size() != path.size()) {
+    return cut(map, tool, path, first, last);
+  }
+  first = std::max<std::size_t>(first, 1);
+  last = std::min(last, path.size());
+  if (first >= last || map.width <= 0 || map.height <= 0) {
+    return {};
+  }
+
+  const float r = 0.5f * tool.diameter;
+  // the centre swings on a circle of radius r while the axis turns, a chord
+  // spanning the angle step sags r (1 - cos(step / 2)) from it
+  const float tolerance = 0.5f * std::min(map.cell_size.x, map.cell_size.y);
+  const float step =
+      tolerance >= r ? glm::pi<float>()
+                     : 2.f * std::acos(1.f - tolerance / r);
+
+  // every sample of every segment, evaluated in one batch
+  std::vector<float> samples;
+  samples.reserve(2 * (last - first) + 1);
+  samples.push_back(static_cast<float>(first - 1));
+  for (std::size_t i = first; i < last; ++i) {
+    float angle;
+    if (method == orientation_method::slerp) {
+      const float d = std::abs(glm::dot(orientation.rotations.get(i - 1),
+                                        orientation.rotations.get(i)));
+      angle = 2.f * std::acos(std::min(1.f, d));
+    } else {
+      // the axis turns no faster than both rotary axes together
+      const auto delta = orientation.euler[i] - orientation.euler[i - 1];
+      angle = std::abs(delta.x) + std::abs(delta.y);
+    }
+    const int pieces = std::max(1, static_cast<int>(std::ceil(angle / step)));
+    for (int k = 1; k <= pieces; ++k) {
+      samples.push_back(static_cast<float>(i - 1) +
+                        static_cast<float>(k) / pieces);
+    }
+  }
+
+  math::quat_soa rotations;
+  rotations.resize(samples.size());
+  orientation.evaluate_batch(method, samples.data(), samples.size(),
+                             rotations.ref());
+
+  // the tip moves linearly between the moves, the centre is a radius along
+  // the axis from it
+  auto centre = [&](std::size_t k) {
+    const float s = samples[k];
+    const auto from = std::min(static_cast<std::size_t>(s), last - 2);
+    const float t = s - static_cast<float>(from);
+    const auto p0 = path.position(from);
+    const auto tip = p0 + t * (path.position(from + 1) - p0);
+    return tip + r * tool_axis(rotations.get(k));
+  };
+
+  std::vector<segment> segments;
+  segments.reserve(samples.size());
+  heightmap_region touched;
+  auto previous = centre(0);
+  for (std::size_t k = 1; k < samples.size(); ++k) {
+    const auto next = centre(k);
+    segment s;
+    if (make_segment(map, r, previous, next, s)) {
+      touched.merge(s.cells);
+      segments.push_back(s);
+    }
+    previous = next;
+  }
+  cut_segments(map, tool.type, r, segments);
+  return touched;
+}
+
+} // namespace pusn
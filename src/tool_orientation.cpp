@@ -0,0 +1,115 @@
+#include <tool_orientation.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace pusn {
+
+namespace {
+
+// gathered end points of the segments of a batch
+struct orientation_scratch {
+  math::quat_soa from;
+  math::quat_soa to;
+  std::vector<float> t;
+  std::vector<math::vec3> angles;
+};
+
+} // namespace
+
+math::vec3 axis_to_euler(const math::vec3 &axis, float previous_b) {
+  // axis = (cos a sin b, -sin a, cos a cos b)
+  const float a = std::asin(std::clamp(-axis.y, -1.f, 1.f));
+  const float horizontal = axis.x * axis.x + axis.z * axis.z;
+  const float b = horizontal > 1e-12f ? std::atan2(axis.x, axis.z) : previous_b;
+  return {a, b, 0.f};
+}
+
+void orientation_track::build(const compiled_toolpath &path) {
+  const std::size_t count = path.size();
+  rotations.resize(count);
+  euler.resize(count);
+  if (!path.has_orientation()) {
+    std::fill(rotations.w.begin(), rotations.w.end(), 1.f);
+    std::fill(rotations.x.begin(), rotations.x.end(), 0.f);
+    std::fill(rotations.y.begin(), rotations.y.end(), 0.f);
+    std::fill(rotations.z.begin(), rotations.z.end(), 0.f);
+    std::fill(euler.begin(), euler.end(), math::vec3{0.f});
+    return;
+  }
+
+  const float pi = glm::pi<float>();
+  const float tau = 2 * glm::pi<float>();
+  float previous_b = 0.f;
+  glm::quat previous{1.f, 0.f, 0.f, 0.f};
+  for (std::size_t i = 0; i < count; ++i) {
+    auto angles = axis_to_euler(path.tool_axis(i), previous_b);
+    if (i > 0) {
+      while (angles.y - previous_b > pi) {
+        angles.y -= tau;
+      }
+      while (angles.y - previous_b < -pi) {
+        angles.y += tau;
+      }
+    }
+    previous_b = angles.y;
+    euler[i] = angles;
+
+    auto q = glm::quat(angles);
+    if (glm::dot(q, previous) < 0.f) {
+      q = -q;
+    }
+    previous = q;
+    rotations.set(i, q);
+  }
+}
+
+void orientation_track::evaluate_batch(orientation_method method,
+                                       const float *s, std::size_t count,
+                                       math::quat_soa_ref out) const {
+  if (empty()) {
+    for (std::size_t i = 0; i < count; ++i) {
+      math::detail::store_quat(out, i, glm::quat(1.f, 0.f, 0.f, 0.f));
+    }
+    return;
+  }
+
+  static thread_local orientation_scratch scratch;
+  const float last = static_cast<float>(size() - 1);
+  scratch.t.resize(count);
+  // index of the segment start of every sample, reused by both methods
+  auto segment = [&](std::size_t i) {
+    const float clamped = std::clamp(s[i], 0.f, last);
+    const auto from = std::min(static_cast<std::size_t>(clamped),
+                               size() > 1 ? size() - 2 : 0);
+    scratch.t[i] = std::min(1.f, clamped - static_cast<float>(from));
+    return from;
+  };
+
+  if (method == orientation_method::slerp) {
+    scratch.from.resize(count);
+    scratch.to.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto from = segment(i);
+      const auto to = std::min(from + 1, size() - 1);
+      scratch.from.set(i, rotations.get(from));
+      scratch.to.set(i, rotations.get(to));
+    }
+    math::slerp_batch(scratch.from.cref(), scratch.to.cref(),
+                      scratch.t.data(), out, count);
+    return;
+  }
+
+  scratch.angles.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto from = segment(i);
+    const auto to = std::min(from + 1, size() - 1);
+    scratch.angles[i] =
+        euler[from] + scratch.t[i] * (euler[to] - euler[from]);
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    math::detail::store_quat(out, i, glm::quat(scratch.angles[i]));
+  }
+}
+
+} // namespace pusn
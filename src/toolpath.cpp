@@ -0,0 +1,288 @@
+#include <toolpath.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+#include <logger.hpp>
+#include <mapped_file.hpp>
+#include <math.hpp>
+
+namespace pusn {
+
+namespace {
+
+constexpr double powers_of_ten[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                    1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17};
+constexpr int max_digits = 17;
+
+inline bool is_digit(char c) { return static_cast<unsigned>(c - '0') < 10u; }
+
+// [-+]digits[.digits] into out, without locale lookups or allocations.
+// Programs carry at most a few decimals so the mantissa fits an integer and
+// a single division rounds it.
+inline bool parse_decimal(const char *&p, const char *end, float &out) {
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+  std::uint64_t mantissa = 0;
+  int digits = 0;
+  int fraction = 0;
+  const char *start = p;
+  // fraction stays within the table, the digits past it are beyond what
+  // a float keeps anyway
+  for (; p != end && is_digit(*p); ++p) {
+    if (digits < max_digits) {
+      mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+      digits += mantissa != 0;
+    } else if (fraction > -max_digits) {
+      --fraction;
+    }
+  }
+  if (p != end && *p == '.') {
+    ++p;
+    for (; p != end && is_digit(*p); ++p) {
+      if (digits < max_digits && fraction < max_digits) {
+        mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+        digits += mantissa != 0;
+        ++fraction;
+      }
+    }
+  }
+  if (p == start || (p == start + 1 && *start == '.')) {
+    return false;
+  }
+  double value = static_cast<double>(mantissa);
+  value = fraction >= 0 ? value / powers_of_ten[fraction]
+                        : value * powers_of_ten[-fraction];
+  out = static_cast<float>(negative ? -value : value);
+  return true;
+}
+
+inline bool parse_integer(const char *&p, const char *end,
+                          std::uint32_t &out) {
+  const auto [next, ec] = std::from_chars(p, end, out);
+  if (ec != std::errc{}) {
+    return false;
+  }
+  p = next;
+  return true;
+}
+
+} // namespace
+
+std::optional<tool_info>
+toolpath_parser::decode_tool(const std::filesystem::path &path) {
+  const auto extension = path.extension().string();
+  // ".k16", the type letter and the diameter in millimeters
+  if (extension.size() < 3) {
+    return std::nullopt;
+  }
+  tool_info out;
+  switch (extension[1]) {
+  case 'k':
+  case 'K':
+    out.type = tool_type::ball;
+    break;
+  case 'f':
+  case 'F':
+    out.type = tool_type::flat;
+    break;
+  default:
+    return std::nullopt;
+  }
+  std::uint32_t diameter = 0;
+  const char *first = extension.data() + 2;
+  const char *last = extension.data() + extension.size();
+  const auto [next, ec] = std::from_chars(first, last, diameter);
+  if (ec != std::errc{} || next != last || diameter == 0) {
+    return std::nullopt;
+  }
+  out.diameter = static_cast<float>(diameter);
+  return out;
+}
+
+bool toolpath_parser::parse(std::string_view text, toolpath &out) {
+  const char *p = text.data();
+  const char *const end = p + text.size();
+
+  // one move per line at most, counting them is a vectorized scan
+  const std::size_t capacity = out.size() + std::count(p, end, '\n') + 1;
+  out.reserve(capacity);
+
+  float position[3] = {0.f, 0.f, 0.f};
+  // modal tool axis, only stored once a line sets it
+  math::vec3 axis{0.f, 0.f, 1.f};
+  float rotary[2] = {0.f, 0.f};
+  // the i, j and k arrays run along with the moves, tracked apart from
+  // has_orientation() which stays false until a move was pushed
+  bool oriented = out.has_orientation();
+  // G00 to G03 stay in effect until another one, lines without a G word
+  // move the same way as the last one
+  std::uint32_t motion = 0xffffffffu;
+  std::uint32_t file_line = 0;
+  // words of letters the parser does not know, without a number after them
+  std::size_t ignored = 0;
+  while (p != end) {
+    ++file_line;
+    const char *line_end =
+        static_cast<const char *>(std::memchr(p, '\n', end - p));
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+
+    std::uint32_t number = file_line;
+    bool has_axis = false;
+    // I, J and K are arc centres on other motions, so the orientation words
+    // are only applied once the line is known to be a G00/G01
+    float vector[3] = {axis.x, axis.y, axis.z};
+    float angles[2] = {rotary[0], rotary[1]};
+    bool has_vector = false;
+    bool has_angles = false;
+    const char *word = p;
+    while (word != line_end) {
+      char letter = *word++;
+      if (letter >= 'a' && letter <= 'z') {
+        letter = static_cast<char>(letter - 'a' + 'A');
+      }
+      bool ok = true;
+      switch (letter) {
+      case ' ':
+      case '\t':
+      case '\r':
+        continue;
+      case '%':
+      case ';':
+        // program delimiter or a comment, up to the end of the line
+        word = line_end;
+        continue;
+      case '(': {
+        const auto *close = static_cast<const char *>(
+            std::memchr(word, ')', line_end - word));
+        word = close == nullptr ? line_end : close + 1;
+        continue;
+      }
+      case 'N':
+        ok = parse_integer(word, line_end, number);
+        break;
+      case 'G': {
+        std::uint32_t code = 0;
+        ok = parse_integer(word, line_end, code);
+        if (code <= 3) {
+          motion = code;
+        }
+        break;
+      }
+      case 'X':
+      case 'Y':
+      case 'Z':
+        ok = parse_decimal(word, line_end, position[letter - 'X']);
+        has_axis = true;
+        break;
+      case 'I':
+      case 'J':
+      case 'K':
+        ok = parse_decimal(word, line_end, vector[letter - 'I']);
+        has_vector = true;
+        break;
+      case 'A':
+      case 'B':
+        ok = parse_decimal(word, line_end, angles[letter - 'A']);
+        has_angles = true;
+        break;
+      default: {
+        // feed, spindle and the like, not needed for the path
+        float value;
+        if (!parse_decimal(word, line_end, value)) {
+          if (ignored++ == 0) {
+            LOGGER_WARN("[TOOLPATH] Ignored word '{0}' in line {1}: {2}",
+                        letter, file_line, std::string_view(p, line_end - p));
+          }
+        }
+        break;
+      }
+      }
+      if (!ok) {
+        LOGGER_ERROR("[TOOLPATH] Malformed word '{0}' in line {1}: {2}", letter,
+                     file_line, std::string_view(p, line_end - p));
+        return false;
+      }
+    }
+
+    const bool moves = motion == 0 || motion == 1;
+    if (moves && (has_vector || has_angles)) {
+      if (has_angles) {
+        rotary[0] = angles[0];
+        rotary[1] = angles[1];
+        const float a = glm::radians(rotary[0]);
+        const float b = glm::radians(rotary[1]);
+        axis = {std::cos(a) * std::sin(b), -std::sin(a),
+                std::cos(a) * std::cos(b)};
+      } else {
+        const math::vec3 v{vector[0], vector[1], vector[2]};
+        const float length = glm::length(v);
+        if (length <= 0.f) {
+          LOGGER_ERROR("[TOOLPATH] Zero tool axis in line {0}", file_line);
+          return false;
+        }
+        axis = v / length;
+      }
+      if (!oriented) {
+        oriented = true;
+        // every earlier move ran along +z
+        out.i.assign(out.size(), 0.f);
+        out.j.assign(out.size(), 0.f);
+        out.k.assign(out.size(), 1.f);
+        out.i.reserve(capacity);
+        out.j.reserve(capacity);
+        out.k.reserve(capacity);
+      }
+    }
+
+    // a line only turning the tool is a move too, else the turn would be
+    // spread over the next segment
+    if (moves && (has_axis || has_vector || has_angles)) {
+      out.x.push_back(position[0]);
+      out.y.push_back(position[1]);
+      out.z.push_back(position[2]);
+      out.line.push_back(number);
+      if (oriented) {
+        out.i.push_back(axis.x);
+        out.j.push_back(axis.y);
+        out.k.push_back(axis.z);
+      }
+    }
+    p = line_end == end ? end : line_end + 1;
+  }
+  if (ignored > 1) {
+    LOGGER_WARN("[TOOLPATH] Ignored {0} words without a number", ignored);
+  }
+  return true;
+}
+
+std::optional<toolpath>
+toolpath_parser::load(const std::filesystem::path &path) {
+  const auto tool = decode_tool(path);
+  if (!tool.has_value()) {
+    LOGGER_ERROR("[TOOLPATH] Unknown tool in extension of {0}", path.string());
+    return std::nullopt;
+  }
+  const auto file = utils::mapped_file::open(path);
+  if (!file.has_value()) {
+    return std::nullopt;
+  }
+
+  toolpath out;
+  out.tool = tool.value();
+  if (!parse(file->view(), out)) {
+    return std::nullopt;
+  }
+  LOGGER_INFO("[TOOLPATH] {0} moves from {1}", out.size(), path.string());
+  return out;
+}
+
+} // namespace pusn
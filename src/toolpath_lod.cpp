@@ -0,0 +1,132 @@
+#include <toolpath_lod.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace pusn {
+
+namespace {
+
+// squared distance of p to the segment from a to b
+float segment_distance2(const math::vec3 &p, const math::vec3 &a,
+                        const math::vec3 &b) {
+  const math::vec3 ab = b - a;
+  const math::vec3 ap = p - a;
+  const float length2 = glm::dot(ab, ab);
+  const float t =
+      length2 > 0.f ? std::clamp(glm::dot(ap, ab) / length2, 0.f, 1.f) : 0.f;
+  const math::vec3 d = ap - t * ab;
+  return glm::dot(d, d);
+}
+
+// the tolerance below which Douglas-Peucker keeps each move: a move is kept
+// when its own split distance and those of every split above it exceed the
+// tolerance, so the minimum along that chain decides. Runs closer than
+// min_tolerance are not split further, none of the levels would keep them.
+std::vector<float> significance(const compiled_toolpath &path,
+                                float min_tolerance) {
+  const std::size_t count = path.size();
+  std::vector<float> out(count, 0.f);
+  if (count == 0) {
+    return out;
+  }
+  out.front() = std::numeric_limits<float>::infinity();
+  out.back() = std::numeric_limits<float>::infinity();
+
+  struct span {
+    std::size_t first;
+    std::size_t last;
+    float parent;
+  };
+  std::vector<span> stack{
+      {0, count - 1, std::numeric_limits<float>::infinity()}};
+  const float min2 = min_tolerance * min_tolerance;
+  while (!stack.empty()) {
+    const auto [first, last, parent] = stack.back();
+    stack.pop_back();
+    if (last - first < 2) {
+      continue;
+    }
+    const auto a = path.position(first);
+    const auto b = path.position(last);
+    float farthest2 = -1.f;
+    std::size_t split = first + 1;
+    for (std::size_t i = first + 1; i < last; ++i) {
+      const float d2 = segment_distance2(path.position(i), a, b);
+      if (d2 > farthest2) {
+        farthest2 = d2;
+        split = i;
+      }
+    }
+    if (farthest2 <= min2) {
+      continue;
+    }
+    const float weight = std::min(parent, std::sqrt(farthest2));
+    out[split] = weight;
+    stack.push_back({first, split, weight});
+    stack.push_back({split, last, weight});
+  }
+  return out;
+}
+
+} // namespace
+
+const polyline_lod &toolpath_lod::select(float max_error) const {
+  for (std::size_t i = levels.size(); i-- > 1;) {
+    if (levels[i].tolerance <= max_error) {
+      return levels[i];
+    }
+  }
+  return levels.front();
+}
+
+std::size_t toolpath_lod::prefix(const polyline_lod &level,
+                                 std::size_t move) const {
+  const auto first = indices.begin() + level.first_index;
+  const auto last = first + level.index_count;
+  return std::upper_bound(first, last, static_cast<std::uint32_t>(move)) -
+         first;
+}
+
+toolpath_lod toolpath_decimation::build(const compiled_toolpath &path,
+                                        float base_tolerance, float ratio,
+                                        std::size_t min_vertices) {
+  toolpath_lod out;
+  const std::size_t count = path.size();
+  out.indices.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    out.indices[i] = static_cast<std::uint32_t>(i);
+  }
+  out.levels.push_back({0.f, 0, count});
+  if (count < 3) {
+    return out;
+  }
+
+  const auto weights = significance(path, base_tolerance);
+  std::vector<std::uint32_t> level;
+  for (float tolerance = base_tolerance;; tolerance *= ratio) {
+    level.clear();
+    for (std::size_t i = 0; i < count; ++i) {
+      if (weights[i] > tolerance) {
+        level.push_back(static_cast<std::uint32_t>(i));
+      }
+    }
+    // identical to the previous level, keep looking at coarser tolerances
+    if (level.size() == out.levels.back().index_count) {
+      if (level.size() <= 2) {
+        break;
+      }
+      continue;
+    }
+    out.levels.push_back({tolerance, out.indices.size(), level.size()});
+    out.indices.insert(out.indices.end(), level.begin(), level.end());
+    if (level.size() < min_vertices) {
+      break;
+    }
+  }
+  return out;
+}
+
+} // namespace pusn
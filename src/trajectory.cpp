@@ -0,0 +1,131 @@
+#include <trajectory.hpp>
+
+namespace pusn {
+
+void internal::trajectory_cache::build(const simulation_settings &settings) {
+  const auto key_count = settings.keyframes.size() + 2;
+  std::vector<math::vec3> positions;
+  std::vector<glm::quat> rotations;
+  std::vector<math::vec3> euler_rotations;
+  positions.reserve(key_count);
+  rotations.reserve(key_count);
+  euler_rotations.reserve(key_count);
+
+  positions.push_back(settings.position_start);
+  rotations.push_back(settings.quat_rotation_start);
+  euler_rotations.push_back(settings.euler_rotation_start);
+  for (const auto &key : settings.keyframes) {
+    positions.push_back(key.position);
+    rotations.push_back(key.quat_rotation);
+    euler_rotations.push_back(key.euler_rotation);
+  }
+  positions.push_back(settings.position_end);
+  rotations.push_back(settings.quat_rotation_end);
+  euler_rotations.push_back(settings.euler_rotation_end);
+
+  // unwrap euler angles so that every segment takes the shorter way around
+  const float pi = glm::pi<float>();
+  const float tau = 2 * glm::pi<float>();
+  for (std::size_t i = 0; i < euler_rotations.size(); ++i) {
+    for (int axis = 0; axis < 3; ++axis) {
+      float &angle = euler_rotations[i][axis];
+      angle = std::fmod(angle, tau);
+      if (i == 0) {
+        continue;
+      }
+      const float previous = euler_rotations[i - 1][axis];
+      while (angle - previous > pi) {
+        angle -= tau;
+      }
+      while (angle - previous < -pi) {
+        angle += tau;
+      }
+    }
+  }
+
+  euler.build(settings.euler_rotation_start, settings.euler_rotation_end);
+
+  motions.clear();
+  screws.clear();
+  motions.reserve(key_count);
+  screws.reserve(key_count - 1);
+  for (std::size_t i = 0; i < key_count; ++i) {
+    motions.push_back(math::make_dual_quat(rotations[i], positions[i]));
+    if (i > 0) {
+      screws.push_back(math::make_screw(motions[i - 1], motions[i]));
+    }
+  }
+
+  position.build(positions);
+  rotation.build(rotations);
+  euler_rotation.build(euler_rotations);
+
+  arc_length.reset();
+  if (settings.constant_speed) {
+    arc_length.emplace();
+    arc_length->build([this](float t) { return position.evaluate(t); });
+  }
+}
+
+namespace {
+
+template <typename LeftRotation, typename LeftPosition, typename RightRotation,
+          typename RightPosition>
+internal::trajectory_evaluators make_evaluators() {
+  using left_t = internal::trajectory_evaluator<LeftRotation, LeftPosition>;
+  using right_t = internal::trajectory_evaluator<RightRotation, RightPosition>;
+  return {left_t::evaluate, left_t::evaluate_strip, right_t::evaluate,
+          right_t::evaluate_strip};
+}
+
+template <typename LeftRotation, typename LeftPosition>
+internal::trajectory_evaluators
+make_evaluators(const internal::simulation_settings &settings) {
+  namespace policy = internal::policy;
+  if (settings.keyframes.empty()) {
+    return make_evaluators<LeftRotation, LeftPosition, policy::euler_rotation,
+                           policy::linear_position>();
+  }
+  return make_evaluators<LeftRotation, LeftPosition,
+                         policy::euler_spline_rotation,
+                         policy::spline_position>();
+}
+
+template <typename Blend>
+internal::trajectory_evaluators
+make_evaluators(const internal::simulation_settings &settings) {
+  namespace policy = internal::policy;
+  if (settings.keyframes.empty()) {
+    return make_evaluators<policy::quat_rotation<Blend>,
+                           policy::linear_position>(settings);
+  }
+  return make_evaluators<policy::squad_rotation<Blend>,
+                         policy::spline_position>(settings);
+}
+
+} // namespace
+
+internal::trajectory_evaluators
+internal::select_evaluators(const simulation_settings &settings) {
+  if (settings.dual_quaternion) {
+    if (settings.screw) {
+      auto out = make_evaluators<policy::rigid_rotation<policy::sclerp>,
+                                 policy::rigid_position>(settings);
+      out.left_affine = rigid_motion_evaluator<policy::sclerp>::evaluate_affine;
+      return out;
+    }
+    auto out = make_evaluators<policy::rigid_rotation<policy::dlb>,
+                               policy::rigid_position>(settings);
+    out.left_affine = rigid_motion_evaluator<policy::dlb>::evaluate_affine;
+    return out;
+  }
+  if (!settings.slerp) {
+    return make_evaluators<policy::lerp>(settings);
+  }
+  if (settings.fast_slerp) {
+    return make_evaluators<policy::fast_slerp>(settings);
+  }
+  return make_evaluators<policy::slerp>(settings);
+}
+
+} // namespace pusn
@@ -0,0 +1,159 @@
+#include <vertex_format.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace pusn {
+
+namespace {
+
+constexpr int cache_size = 32;
+
+// Forsyth's scoring, recently used vertices and vertices with few
+// triangles left are preferred
+float vertex_score(int cache_position, int remaining) {
+  if (remaining == 0) {
+    return -1.f;
+  }
+  float score = 0.f;
+  if (cache_position >= 0) {
+    // the last triangle's vertices get a fixed score so it is not reused
+    // right away
+    score = cache_position < 3
+                ? 0.75f
+                : std::pow(1.f - static_cast<float>(cache_position - 3) /
+                                     (cache_size - 3),
+                           1.5f);
+  }
+  return score + 2.f / std::sqrt(static_cast<float>(remaining));
+}
+
+} // namespace
+
+packed_mesh pack_mesh(const api_agnostic_geometry &geometry) {
+  packed_mesh out;
+  out.vertices.reserve(geometry.vertices.size());
+  for (const auto &v : geometry.vertices) {
+    out.vertices.push_back(pack_vertex(v));
+  }
+  if (geometry.vertices.size() <= std::numeric_limits<std::uint16_t>::max()) {
+    out.indices16.assign(geometry.indices.begin(), geometry.indices.end());
+  } else {
+    out.indices32.assign(geometry.indices.begin(), geometry.indices.end());
+  }
+  return out;
+}
+
+std::vector<unsigned int>
+optimize_vertex_cache(const std::vector<unsigned int> &indices,
+                      std::size_t vertex_count) {
+  const std::size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return indices;
+  }
+
+  // triangles of every vertex, the first remaining[v] entries of its range
+  // are the ones not emitted yet
+  std::vector<int> remaining(vertex_count, 0);
+  for (const auto i : indices) {
+    ++remaining[i];
+  }
+  std::vector<std::size_t> offsets(vertex_count + 1, 0);
+  for (std::size_t v = 0; v < vertex_count; ++v) {
+    offsets[v + 1] = offsets[v] + remaining[v];
+  }
+  std::vector<std::size_t> triangles(indices.size());
+  {
+    std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t t = 0; t < triangle_count; ++t) {
+      for (int k = 0; k < 3; ++k) {
+        triangles[fill[indices[3 * t + k]]++] = t;
+      }
+    }
+  }
+
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> score(vertex_count);
+  for (std::size_t v = 0; v < vertex_count; ++v) {
+    score[v] = vertex_score(-1, remaining[v]);
+  }
+  std::vector<float> triangle_score(triangle_count);
+  std::vector<bool> emitted(triangle_count, false);
+  std::size_t best = 0;
+  for (std::size_t t = 0; t < triangle_count; ++t) {
+    triangle_score[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] +
+                        score[indices[3 * t + 2]];
+    if (triangle_score[t] > triangle_score[best]) {
+      best = t;
+    }
+  }
+
+  std::vector<unsigned int> out;
+  out.reserve(indices.size());
+  std::vector<unsigned int> cache;
+  std::vector<unsigned int> next_cache;
+  cache.reserve(cache_size + 3);
+  next_cache.reserve(cache_size + 3);
+  std::size_t scan = 0;
+  const auto none = std::numeric_limits<std::size_t>::max();
+
+  for (std::size_t emitted_count = 0; emitted_count < triangle_count;
+       ++emitted_count) {
+    if (best == none) {
+      // nothing in the cache touches a pending triangle, take the next one
+      while (emitted[scan]) {
+        ++scan;
+      }
+      best = scan;
+    }
+
+    emitted[best] = true;
+    next_cache.clear();
+    for (int k = 0; k < 3; ++k) {
+      const auto v = indices[3 * best + k];
+      out.push_back(v);
+      next_cache.push_back(v);
+      // drop the triangle from the pending ones of the vertex
+      auto *first = triangles.data() + offsets[v];
+      auto *last = first + remaining[v];
+      *std::find(first, last, best) = *(last - 1);
+      --remaining[v];
+    }
+    for (const auto v : cache) {
+      if (v != next_cache[0] && v != next_cache[1] && v != next_cache[2]) {
+        next_cache.push_back(v);
+      }
+    }
+
+    for (std::size_t i = 0; i < next_cache.size(); ++i) {
+      const auto v = next_cache[i];
+      cache_position[v] = i < cache_size ? static_cast<int>(i) : -1;
+      score[v] = vertex_score(cache_position[v], remaining[v]);
+    }
+
+    // only triangles around the touched vertices change their score
+    best = none;
+    float best_score = -1.f;
+    for (const auto v : next_cache) {
+      for (int i = 0; i < remaining[v]; ++i) {
+        const auto t = triangles[offsets[v] + i];
+        triangle_score[t] = score[indices[3 * t]] +
+                            score[indices[3 * t + 1]] +
+                            score[indices[3 * t + 2]];
+        if (triangle_score[t] > best_score) {
+          best_score = triangle_score[t];
+          best = t;
+        }
+      }
+    }
+
+    if (next_cache.size() > cache_size) {
+      next_cache.resize(cache_size);
+    }
+    std::swap(cache, next_cache);
+  }
+  return out;
+}
+
+} // namespace pusn